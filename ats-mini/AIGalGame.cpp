@@ -28,7 +28,8 @@ static String uiLogOverlay=""; static uint32_t uiLogOverlayTs=0; // high priorit
 static void ggUILogf(const char *fmt,...){ char buf[160]; va_list ap; va_start(ap,fmt); vsnprintf(buf,sizeof(buf),fmt,ap); va_end(ap); uiLogLine=String(buf); uiLogTs=millis(); }
 static void ggUILogOverlayf(const char *fmt,...){ char buf[160]; va_list ap; va_start(ap,fmt); vsnprintf(buf,sizeof(buf),fmt,ap); va_end(ap); uiLogOverlay=String(buf); uiLogOverlayTs=millis(); }
 static void mirrorOverlayToStatus(){ if(uiLogOverlay.length()) fetchStatus = uiLogOverlay.substring(0,60); }
-static void ggLogDual(const char *tag,const char *fmt,...){ char msg[192]; va_list ap; va_start(ap,fmt); vsnprintf(msg,sizeof(msg),fmt,ap); va_end(ap); Serial.printf("[%s] %s\n", tag, msg); Serial.flush(); uiLogLine=String(msg); uiLogTs=millis(); }
+static TaskHandle_t ggNetTask=NULL; // network task running HTTP requests, see galgameNetWork()
+static void ggLogDual(const char *tag,const char *fmt,...){ char msg[192]; va_list ap; va_start(ap,fmt); vsnprintf(msg,sizeof(msg),fmt,ap); va_end(ap); Serial.printf("[%s] %s\n", tag, msg); Serial.flush(); if(xTaskGetCurrentTaskHandle()!=ggNetTask){ uiLogLine=String(msg); uiLogTs=millis(); } } // on-screen log belongs to loop()
 #define GG_LOG(fmt, ...) ggLogDual("GG", fmt, ##__VA_ARGS__)
 #define GG_LOG_ERROR(fmt, ...) ggLogDual("GG-ERR", fmt, ##__VA_ARGS__)
 #define GG_LOG_HTTP(fmt, ...) ggLogDual("GG-HTTP", fmt, ##__VA_ARGS__)
@@ -586,6 +587,128 @@ static bool httpPostJSON(const char* url, const String &payload, String &respons
   return success;
 }
 
+// HTTP request run by the network task, so that loop() keeps going while
+// the AI service answers. ggPost() fills it in and sets busy, the network
+// task clears busy when done, galgameLoop() then passes the response on.
+enum GGJobKind { GG_JOB_NONE=0, GG_JOB_SUMMARIZE, GG_JOB_CHAT, GG_JOB_IMAGE, GG_JOB_PROJECT };
+static struct {
+  GGJobKind kind; const char *url; String payload; String response; bool ok;
+  String imgPath; size_t imgBytes; GGImageFormat imgFormat; uint32_t imgSamples; uint8_t imgR,imgG,imgB; // image fetched from URL
+  volatile bool busy;
+} ggJob;
+
+static bool ggPost(GGJobKind kind, const char *url, const String &payload){
+  if(ggJob.busy) return false;
+  ggJob.kind=kind; ggJob.url=url; ggJob.payload=payload; ggJob.response=""; ggJob.ok=false;
+  ggJob.imgPath=currentProject.dir+"/last_image.bin"; ggJob.imgBytes=0; ggJob.imgSamples=0; ggJob.imgFormat=IMG_FMT_NONE;
+  ggJob.busy=true;
+  if(netRequest(NET_CMD_GALGAME)) return true;
+  ggJob.busy=false; ggJob.kind=GG_JOB_NONE; ggJob.payload="";
+  GG_LOG_ERROR("Network task busy");
+  return false;
+}
+
+// Download the image the generator returned a URL for into ggJob.imgPath.
+// Runs in the network task, results go into ggJob for parseAndStoreImage().
+static void fetchImageUrl(const String &url){
+  // Fetch binary (改进持续读取，直到 Content-Length 满足或超时)
+  HTTPClient hc; if(hc.begin(url)){
+    hc.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
+    hc.addHeader("Accept","image/jpeg,application/octet-stream;q=0.9,*/*;q=0.5");
+    // 某些服务需要鉴权才能访问生成文件
+    if(AI_API_KEY && strlen(AI_API_KEY)>4) hc.addHeader("Authorization", String("Bearer ")+AI_API_KEY);
+    hc.addHeader("User-Agent","ATS-MINI-GalGame/1.0");
+    int code = hc.GET();
+    String ctype = hc.header("Content-Type");
+    if(code==200){
+      int expected = hc.getSize(); // -1 if unknown
+      GG_LOG_HTTP("IMG GET 200 Len=%d Type=%s", expected, ctype.c_str());
+      // If Content-Type missing, proceed and rely on SOI/EOI + size sniff; only abort when an explicit non-image type present
+      if(!ctype.length()){
+        GG_LOG_HTTP("IMG no Content-Type header; will sniff JPEG markers");
+        int hcount = hc.headers();
+        for(int i=0;i<hcount;i++){
+          String hn = hc.headerName(i);
+          String hv = hc.header(hn.c_str());
+          GG_LOG_HTTP("HDR %s: %s", hn.c_str(), hv.c_str());
+        }
+      } else if(!ctype.startsWith("image")){
+        GG_LOG_HTTP("IMG abort: content-type %s", ctype.c_str());
+        int hcount = hc.headers();
+        for(int i=0;i<hcount;i++){
+          String hn = hc.headerName(i);
+          String hv = hc.header(hn.c_str());
+          GG_LOG_HTTP("HDR %s: %s", hn.c_str(), hv.c_str());
+        }
+        hc.end();
+        return; // do not mark haveImage
+      }
+      File f = LittleFS.open(ggJob.imgPath,"w");
+      if(f){
+        WiFiClient * stream = hc.getStreamPtr();
+  uint8_t buf[1024]; size_t total=0; uint32_t accR=0,accG=0,accB=0,sample=0; uint32_t lastRead=millis(); bool sawSOI=false; bool foundEOI=false; uint8_t prev=0; size_t eoiPos=0; uint8_t first8[8]; int firstFill=0;
+        while(hc.connected()){
+          if(stream->available()){
+            int r = stream->readBytes(buf,sizeof(buf)); if(r<=0) break; lastRead=millis();
+            // Detect SOI
+            if(!sawSOI && r>=2){ if(buf[0]==0xFF && buf[1]==0xD8) sawSOI=true; }
+    if(firstFill<8){ int need=8-firstFill; int take=r<need?r:need; memcpy(first8+firstFill, buf, take); firstFill+=take; }
+            
+            // Don't truncate at EOI - download the complete file as specified by Content-Length
+            int writeLen = r;
+            for(int i=0;i<r;i++){
+              uint8_t b = buf[i];
+              if(prev==0xFF && b==0xD9){ foundEOI=true; eoiPos = total + i + 1; }
+              prev = b;
+            }
+            f.write(buf, writeLen); total += writeLen;
+            for(int i=0;i<writeLen;i+=64){ uint8_t v=buf[i]; accR+=v; accG+= (v*37+17)&0xFF; accB+= (v*73+5)&0xFF; sample++; }
+            
+            // Only break if we have expected length and reached it, or if no expected length and we found EOI
+            if(expected>0 && (int)total>=expected) {
+              GG_LOG_HTTP("IMG complete at %d bytes (expected %d)%s", (int)total, expected, foundEOI?" with EOI":"");
+              break;
+            } else if(expected<=0 && foundEOI) {
+              GG_LOG_HTTP("IMG EOI at %d bytes (no Content-Length)", (int)eoiPos);
+              break;
+            }
+            // 不再强制总大小上限，依赖 expected / timeout 退出
+          } else {
+            if(millis()-lastRead>600) { GG_LOG_HTTP("IMG idle timeout"); break; }
+            delay(5);
+          }
+        }
+        f.close();
+        ggJob.imgSamples=sample; if(sample){ ggJob.imgR=(accR/sample)&0xFF; ggJob.imgG=(accG/sample)&0xFF; ggJob.imgB=(accB/sample)&0xFF; }
+        if(!sawSOI){ GG_LOG_HTTP("IMG warn: no SOI marker"); }
+        if(!foundEOI){ GG_LOG_HTTP("IMG warn: no EOI marker (truncated?)"); }
+        GGImageFormat fmt; if(sawSOI) fmt = IMG_FMT_JPEG; else if(firstFill>=8 && first8[0]==0x89 && first8[1]==0x50 && first8[2]==0x4E && first8[3]==0x47) fmt = IMG_FMT_PNG; else fmt = IMG_FMT_NONE;
+        GG_LOG_HTTP("IMG header %02X %02X %02X %02X %02X %02X %02X %02X fmt=%d", firstFill>0?first8[0]:0, firstFill>1?first8[1]:0, firstFill>2?first8[2]:0, firstFill>3?first8[3]:0, firstFill>4?first8[4]:0, firstFill>5?first8[5]:0, firstFill>6?first8[6]:0, firstFill>7?first8[7]:0, (int)fmt);
+        if(fmt==IMG_FMT_NONE || total<128){ GG_LOG_HTTP("IMG invalid, discard (fmt=%d size=%d)", (int)fmt, (int)total); LittleFS.remove(ggJob.imgPath); return; }
+        ggJob.imgBytes=total; ggJob.imgFormat=fmt;
+        GG_LOG_HTTP("IMG fetched %d bytes (exp=%d)%s%s", (int)total, expected, foundEOI?" EOI":"", (!foundEOI && expected<0)?" unkLen":"");
+      } else GG_LOG_HTTP("IMG file open fail");
+    } else GG_LOG_HTTP("IMG GET code %d", code);
+    hc.end();
+  } else GG_LOG_HTTP("IMG begin fail");
+}
+
+// Run the request ggPost() queued, called by the network task
+void galgameNetWork(){
+  ggNetTask = xTaskGetCurrentTaskHandle();
+  ggJob.ok = httpPostJSON(ggJob.url, ggJob.payload, ggJob.response);
+  // Image generators may answer with a URL, fetch the image along
+  if(ggJob.ok && ggJob.kind==GG_JOB_IMAGE){
+    int nl=ggJob.response.indexOf('\n'); DynamicJsonDocument dj(8192);
+    if(!deserializeJson(dj, ggJob.response.c_str()+(nl>0? nl+1:0))){
+      JsonVariant u = dj["images"][0]["url"];
+      if(u.is<const char*>()) fetchImageUrl(u.as<String>());
+    }
+  }
+  // Hand the results back to loop()
+  __sync_synchronize(); ggJob.busy=false;
+}
+
 static void parseAndStoreImage(const String &json) {
   // Reset all image state
   haveImage=false; imageDecoded=false; lastImageB64=""; lastImageUrl=""; imageFromUrl=false; lastImageBytes=0;
@@ -602,87 +725,12 @@ static void parseAndStoreImage(const String &json) {
         lastImageUrl = first["url"].as<String>(); // will set haveImage true after successful fetch
         imageThumbReady=false; imageDecoded=false; jpgFullW=jpgFullH=0; jpgScaledW=jpgScaledH=0; memset(imageThumb,0xFF,sizeof(imageThumb));
         GG_LOG_HTTP("IMG url: %s", lastImageUrl.c_str());
-        // Fetch binary (改进持续读取，直到 Content-Length 满足或超时)
-    HTTPClient hc; if(hc.begin(lastImageUrl)){
-          hc.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
-          hc.addHeader("Accept","image/jpeg,application/octet-stream;q=0.9,*/*;q=0.5");
-          // 某些服务需要鉴权才能访问生成文件
-          if(AI_API_KEY && strlen(AI_API_KEY)>4) hc.addHeader("Authorization", String("Bearer ")+AI_API_KEY);
-          hc.addHeader("User-Agent","ATS-MINI-GalGame/1.0");
-          int code = hc.GET();
-          String ctype = hc.header("Content-Type");
-          if(code==200){
-            int expected = hc.getSize(); // -1 if unknown
-            GG_LOG_HTTP("IMG GET 200 Len=%d Type=%s", expected, ctype.c_str());
-            // If Content-Type missing, proceed and rely on SOI/EOI + size sniff; only abort when an explicit non-image type present
-            if(!ctype.length()){
-              GG_LOG_HTTP("IMG no Content-Type header; will sniff JPEG markers");
-              int hcount = hc.headers();
-              for(int i=0;i<hcount;i++){
-                String hn = hc.headerName(i);
-                String hv = hc.header(hn.c_str());
-                GG_LOG_HTTP("HDR %s: %s", hn.c_str(), hv.c_str());
-              }
-            } else if(!ctype.startsWith("image")){
-              GG_LOG_HTTP("IMG abort: content-type %s", ctype.c_str());
-              int hcount = hc.headers();
-              for(int i=0;i<hcount;i++){
-                String hn = hc.headerName(i);
-                String hv = hc.header(hn.c_str());
-                GG_LOG_HTTP("HDR %s: %s", hn.c_str(), hv.c_str());
-              }
-              hc.end();
-              return; // do not mark haveImage
-            }
-            File f = LittleFS.open(currentProject.dir+"/last_image.bin","w");
-            if(f){
-              WiFiClient * stream = hc.getStreamPtr();
-        uint8_t buf[1024]; size_t total=0; uint32_t accR=0,accG=0,accB=0,sample=0; uint32_t lastRead=millis(); bool sawSOI=false; bool foundEOI=false; uint8_t prev=0; size_t eoiPos=0; uint8_t first8[8]; int firstFill=0;
-              while(hc.connected()){
-                if(stream->available()){
-                  int r = stream->readBytes(buf,sizeof(buf)); if(r<=0) break; lastRead=millis();
-                  // Detect SOI
-                  if(!sawSOI && r>=2){ if(buf[0]==0xFF && buf[1]==0xD8) sawSOI=true; }
-          if(firstFill<8){ int need=8-firstFill; int take=r<need?r:need; memcpy(first8+firstFill, buf, take); firstFill+=take; }
-                  
-                  // Don't truncate at EOI - download the complete file as specified by Content-Length
-                  int writeLen = r;
-                  for(int i=0;i<r;i++){
-                    uint8_t b = buf[i];
-                    if(prev==0xFF && b==0xD9){ foundEOI=true; eoiPos = total + i + 1; }
-                    prev = b;
-                  }
-                  f.write(buf, writeLen); total += writeLen;
-                  for(int i=0;i<writeLen;i+=64){ uint8_t v=buf[i]; accR+=v; accG+= (v*37+17)&0xFF; accB+= (v*73+5)&0xFF; sample++; }
-                  
-                  // Only break if we have expected length and reached it, or if no expected length and we found EOI
-                  if(expected>0 && (int)total>=expected) {
-                    GG_LOG_HTTP("IMG complete at %d bytes (expected %d)%s", (int)total, expected, foundEOI?" with EOI":"");
-                    break;
-                  } else if(expected<=0 && foundEOI) {
-                    GG_LOG_HTTP("IMG EOI at %d bytes (no Content-Length)", (int)eoiPos);
-                    break;
-                  }
-                  // 不再强制总大小上限，依赖 expected / timeout 退出
-                } else {
-                  if(millis()-lastRead>600) { GG_LOG_HTTP("IMG idle timeout"); break; }
-                  delay(5);
-                }
-              }
-              f.close();
-              lastImageBytes = total;
-              if(sample){ uint8_t r=(accR/sample)&0xFF, g=(accG/sample)&0xFF, b=(accB/sample)&0xFF; imageColor=tft.color565(r,g,b);} else imageColor=TFT_NAVY;
-              if(!sawSOI){ GG_LOG_HTTP("IMG warn: no SOI marker"); }
-              if(!foundEOI){ GG_LOG_HTTP("IMG warn: no EOI marker (truncated?)"); }
-              if(sawSOI) lastImageFormat = IMG_FMT_JPEG; else if(firstFill>=8 && first8[0]==0x89 && first8[1]==0x50 && first8[2]==0x4E && first8[3]==0x47) lastImageFormat = IMG_FMT_PNG; else lastImageFormat = IMG_FMT_NONE;
-              GG_LOG_HTTP("IMG header %02X %02X %02X %02X %02X %02X %02X %02X fmt=%d", firstFill>0?first8[0]:0, firstFill>1?first8[1]:0, firstFill>2?first8[2]:0, firstFill>3?first8[3]:0, firstFill>4?first8[4]:0, firstFill>5?first8[5]:0, firstFill>6?first8[6]:0, firstFill>7?first8[7]:0, (int)lastImageFormat);
-              if(lastImageFormat==IMG_FMT_NONE || total<128){ GG_LOG_HTTP("IMG invalid, discard (fmt=%d size=%d)", (int)lastImageFormat, (int)total); LittleFS.remove(currentProject.dir+"/last_image.bin"); return; }
-              haveImage=true; imageFromUrl=true; imageThumbReady=false; imageDecoded=false; jpgFullW=jpgFullH=0; jpgScaledW=jpgScaledH=0; memset(imageThumb,0xFF,sizeof(imageThumb));
-              GG_LOG_HTTP("IMG fetched %d bytes (exp=%d)%s%s", (int)total, expected, foundEOI?" EOI":"", (!foundEOI && expected<0)?" unkLen":"");
-            } else GG_LOG_HTTP("IMG file open fail");
-          } else GG_LOG_HTTP("IMG GET code %d", code);
-          hc.end();
-        } else GG_LOG_HTTP("IMG begin fail");
+        // Downloaded by the network task along with the response, see fetchImageUrl()
+        if(!ggJob.imgBytes) return; // do not mark haveImage
+        lastImageBytes = ggJob.imgBytes; lastImageFormat = ggJob.imgFormat;
+        imageColor = ggJob.imgSamples? tft.color565(ggJob.imgR,ggJob.imgG,ggJob.imgB) : TFT_NAVY;
+        haveImage=true; imageFromUrl=true;
+        GG_LOG_HTTP("IMG fetched %d bytes", (int)lastImageBytes);
         return; // done (URL path)
       }
       // fallback: maybe base64 field inside object
@@ -712,12 +760,8 @@ static uint32_t summarizeStartTs = 0; // time when async summarize started
 static void startSummarizeAsync(){
   if(fetching || summarizePending) return; summarizePending=true; summarizeStartTs=millis(); fetchStatus="Summarize queued"; }
 
-static void doSummarizeNow(){
-  if(fetching) return; fetching=true; fetchStatus="Summarizing...";
-  DynamicJsonDocument jd(8192); jd["model"]=AI_CHAT_MODEL; JsonArray msgs=jd.createNestedArray("messages");
-  JsonObject sys=msgs.createNestedObject(); sys["role"]="system"; sys["content"]="Summarize narrative facts into concise bullet points (max 12)";
-  JsonObject u=msgs.createNestedObject(); u["role"]="user"; u["content"] = sessionLog.substring(sessionLog.length()>6000? sessionLog.length()-6000:0);
-  String payload; serializeJson(jd,payload); String resp; if(httpPostJSON(AI_CHAT_URL,payload,resp)) {
+static void summarizeDone(bool ok, const String &resp){
+  if(ok) {
     int nl=resp.indexOf('\n'); String body = (nl>0)? resp.substring(nl+1):resp; DynamicJsonDocument dr(8192); if(!deserializeJson(dr,body)) {
       String add = dr["choices"][0]["message"]["content"].as<String>();
       if(add.length()) { knowledgeBase += "\n"+add; if(knowledgeBase.length()>6000) knowledgeBase.remove(0, knowledgeBase.length()-6000); saveMeta(); lastAIText="Knowledge +"; }
@@ -726,7 +770,19 @@ static void doSummarizeNow(){
   fetching=false; fetchStatus="Done"; summarizePending=false; retryCount=0;
 }
 
+static void doSummarizeNow(){
+  if(fetching) return; fetching=true; fetchStatus="Summarizing...";
+  DynamicJsonDocument jd(8192); jd["model"]=AI_CHAT_MODEL; JsonArray msgs=jd.createNestedArray("messages");
+  JsonObject sys=msgs.createNestedObject(); sys["role"]="system"; sys["content"]="Summarize narrative facts into concise bullet points (max 12)";
+  JsonObject u=msgs.createNestedObject(); u["role"]="user"; u["content"] = sessionLog.substring(sessionLog.length()>6000? sessionLog.length()-6000:0);
+  String payload; serializeJson(jd,payload);
+  if(!ggPost(GG_JOB_SUMMARIZE, AI_CHAT_URL, payload)) summarizeDone(false, String()); // else continues in summarizeDone()
+}
+
 static void requestAI(); // fwd
+static void aiChatDone(bool ok, const String &resp); // fwd
+static void aiImageDone(bool ok, const String &ir); // fwd
+static void projectGenDone(bool ok, const String &resp); // fwd
 static bool writeImageFileFromB64(const String &b64); // fwd
 static void buildThumbnails(); // fwd
 // forward decls removed (function defined earlier)
@@ -1025,7 +1081,11 @@ static void requestAI() {
   for(auto &e: context) { JsonObject m=msgs.createNestedObject(); m["role"]=e.role; m["content"]=e.content; }
   JsonObject userQ = msgs.createNestedObject(); userQ["role"]="user"; userQ["content"]="Continue the interactive visual novel. Produce JSON ONLY (no markdown).";
   String payload; serializeJson(jd,payload);
-  String resp; bool ok = httpPostJSON(AI_CHAT_URL, payload, resp);
+  if(!ggPost(GG_JOB_CHAT, AI_CHAT_URL, payload)) aiChatDone(false, String()); // else continues in aiChatDone()
+}
+
+// Chat response, see requestAI()
+static void aiChatDone(bool ok, const String &resp) {
   int statusCode = -1; if(resp.length()){ int nl=resp.indexOf('\n'); if(nl>0) statusCode = resp.substring(0,nl).toInt(); }
   if(!ok){
     bool retryable = (statusCode==429) || (statusCode>=500 && statusCode<600) || statusCode==-1;
@@ -1080,27 +1140,32 @@ static void requestAI() {
     haveImage=false; imageDecoded=false; lastImageB64="";
   DynamicJsonDocument ji(4096); ji["model"]=AI_IMG_MODEL; ji["prompt"]=imagePrompt; ji["image_size"]="480x288"; ji["num_inference_steps"]=20; ji["guidance_scale"]=7.5; ji["batch_size"]=1; // Kolors spec (480x288)
     String ip; serializeJson(ji,ip); ggUILogOverlayf("IMG post %d", ip.length()); mirrorOverlayToStatus();
-    String ir; if(httpPostJSON(AI_IMAGE_URL, ip, ir)) {
-      ggUILogOverlayf("IMG resp %d", ir.length()); mirrorOverlayToStatus();
-      int nli=ir.indexOf('\n'); String bodyi=(nli>0)? ir.substring(nli+1):ir; // 修正变量名错误
-      File f=LittleFS.open(currentProject.dir+"/last_image.json","w"); if(f){ f.print(bodyi); f.close(); }
-      parseAndStoreImage(bodyi);
-      ggUILogOverlayf("IMG flags img=%d url=%d b64len=%d", haveImage?1:0, imageFromUrl?1:0, lastImageB64.length()); mirrorOverlayToStatus();
-      if(haveImage && lastImageB64.length()) {
-        writeImageFileFromB64(lastImageB64); buildThumbnails(); ggUILogOverlayf("IMG b64 stored"); mirrorOverlayToStatus();
-      } else if(haveImage && imageFromUrl){
-        ggUILogOverlayf("IMG url fetched"); mirrorOverlayToStatus();
-        tryDecodeImage(); // 立即尝试解码URL图片
-      } else {
-        ggUILogOverlayf("IMG none after parse"); mirrorOverlayToStatus();
-      }
-    } else { ggUILogOverlayf("IMG netfail"); mirrorOverlayToStatus(); }
-  if(haveImage) fetchStatus = String("Img OK ") + String((unsigned long)lastImageBytes) + "B"; else if(fetchStatus.startsWith("Gen Img")) fetchStatus = "Img Fail"; // 保留结果
-  } else {
-    ggUILogOverlayf("IMG skip no prompt"); mirrorOverlayToStatus();
-    fetchStatus="OK";
+    if(!ggPost(GG_JOB_IMAGE, AI_IMAGE_URL, ip)) aiImageDone(false, String()); // else continues in aiImageDone()
+    return;
   }
-  if(!imagePrompt.length() || haveImage || (!haveImage && imagePrompt.length())) { fetching=false; saveMeta(); }
+  ggUILogOverlayf("IMG skip no prompt"); mirrorOverlayToStatus();
+  fetchStatus="OK"; fetching=false; saveMeta();
+}
+
+// Image response, see aiChatDone()
+static void aiImageDone(bool ok, const String &ir) {
+  if(ok) {
+    ggUILogOverlayf("IMG resp %d", ir.length()); mirrorOverlayToStatus();
+    int nli=ir.indexOf('\n'); String bodyi=(nli>0)? ir.substring(nli+1):ir; // 修正变量名错误
+    File f=LittleFS.open(currentProject.dir+"/last_image.json","w"); if(f){ f.print(bodyi); f.close(); }
+    parseAndStoreImage(bodyi);
+    ggUILogOverlayf("IMG flags img=%d url=%d b64len=%d", haveImage?1:0, imageFromUrl?1:0, lastImageB64.length()); mirrorOverlayToStatus();
+    if(haveImage && lastImageB64.length()) {
+      writeImageFileFromB64(lastImageB64); buildThumbnails(); ggUILogOverlayf("IMG b64 stored"); mirrorOverlayToStatus();
+    } else if(haveImage && imageFromUrl){
+      ggUILogOverlayf("IMG url fetched"); mirrorOverlayToStatus();
+      tryDecodeImage(); // 立即尝试解码URL图片
+    } else {
+      ggUILogOverlayf("IMG none after parse"); mirrorOverlayToStatus();
+    }
+  } else { ggUILogOverlayf("IMG netfail"); mirrorOverlayToStatus(); }
+  if(haveImage) fetchStatus = String("Img OK ") + String((unsigned long)lastImageBytes) + "B"; else if(fetchStatus.startsWith("Gen Img")) fetchStatus = "Img Fail"; // 保留结果
+  fetching=false; saveMeta();
 }
 
 static void newProjectGenerate() {
@@ -1138,9 +1203,12 @@ static void newProjectGenerate() {
   GG_LOG_HTTP("Serialized payload size: %zu bytes", payloadSize);
   GG_LOG_HTTP("Request payload: %s", payload.c_str());
   
-  String resp;
   GG_LOG_HTTP("Calling httpPostJSON...");
-  bool ok=httpPostJSON(AI_CHAT_URL,payload,resp);
+  if(!ggPost(GG_JOB_PROJECT, AI_CHAT_URL, payload)) projectGenDone(false, String()); // else continues in projectGenDone()
+}
+
+// Project meta response, see newProjectGenerate()
+static void projectGenDone(bool ok, const String &resp) {
   GG_LOG_HTTP("httpPostJSON returned: %s, response length: %d", ok ? "SUCCESS" : "FAILED", resp.length());
   
   if(ok) { 
@@ -1648,6 +1716,17 @@ void galgameLoop() {
     for(auto &os: optionStats){ os.weight *= GLOBAL_DECAY; }
     optionStats.erase(std::remove_if(optionStats.begin(), optionStats.end(), [](const OptionStat &o){ return o.weight < 0.05f; }), optionStats.end());
   }
+  // Pass on the response once the network task is done with the request
+  if(ggJob.kind && !ggJob.busy){
+    __sync_synchronize(); GGJobKind kind=ggJob.kind; String resp=ggJob.response; ggJob.kind=GG_JOB_NONE; ggJob.payload=""; ggJob.response="";
+    switch(kind){
+      case GG_JOB_SUMMARIZE: summarizeDone(ggJob.ok, resp); break;
+      case GG_JOB_CHAT: aiChatDone(ggJob.ok, resp); break;
+      case GG_JOB_IMAGE: aiImageDone(ggJob.ok, resp); break;
+      case GG_JOB_PROJECT: projectGenDone(ggJob.ok, resp); break;
+      default: break;
+    }
+  }
   if(summarizePending && !fetching) doSummarizeNow();
   else if(aiRetryScheduled && !fetching && millis()>=aiRetryDueMs) requestAI();
   else if(ggState==GG_RUNNING && !fetching && lastAIText=="" && !summarizePending) requestAI();
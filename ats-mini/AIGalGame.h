@@ -34,6 +34,7 @@ void galgameInit();
 void galgameEnter();
 bool galgameActive();
 void galgameLoop();
+void galgameNetWork();
 void galgameEncoder(int dir, bool click, bool longPress, bool shortPress);
 void galgameDraw();
 void galgameLeave();
@@ -145,6 +145,7 @@ extern uint16_t currentCmd;
 extern uint16_t currentBrt;
 extern uint16_t currentSleep;
 extern uint8_t sleepModeIdx;
+extern uint8_t scanModeIdx;
 extern bool zoomMenu;
 extern int8_t scrollDirection;
 extern uint8_t utcOffsetIdx;
@@ -183,9 +184,36 @@ float batteryMonitor();
 bool drawBattery(int x, int y);
 
 // Scan.c
-void scanRun(uint16_t centerFreq, uint16_t step);
-float scanGetRSSI(uint16_t freq);
-float scanGetSNR(uint16_t freq);
+#define SCAN_GRAPH_HEIGHT 40  // Scan graph height (pixels)
+#define SCAN_GRAPH_UNIT   10  // Scan graph horizontal unit (8 pixels)
+void scanStart(uint16_t centerFreq, uint16_t step, bool adaptive = false, bool repeat = false);
+void scanStop();
+bool scanRunning();
+bool scanTickTime();
+float scanGetRate();
+uint16_t scanGetSettleTime();
+int scanGetSettleCurve(uint16_t *times, uint8_t *rssi, int maxCount, int *stcTime = NULL);
+const uint8_t *scanGetGraph(bool snr, uint16_t *freq, int *count);
+uint32_t scanGetSweeps();
+int scanGetHistoryCount();
+float scanGetHistoryRSSI(int age, uint16_t freq);
+float scanGetMaxHold(uint16_t freq);
+float scanGetAverage(uint16_t freq);
+int scanGetPeaks(struct ScanPeak *peaks, int maxPeaks);
+int scanSavePeaks(int maxCount);
+size_t scanExport(Stream &out, const char *label = NULL);
+
+// Monitor.cpp
+void monitorInit();
+bool monitorTickTime();
+bool monitorRunning();
+void monitorStart();
+void monitorStop();
+void monitorSet(uint16_t interval, uint32_t bandMask);
+uint16_t monitorGetInterval();
+uint32_t monitorGetBands();
+uint32_t monitorDefaultBands();
+void monitorDumpLog(Stream &out);
 
 // Station.c
 const char *getStationName();
@@ -207,6 +235,31 @@ bool ntpSyncTime();
 
 void netRequestConnect();
 void netTickTime();
+bool netLock();
+void netUnlock();
+uint32_t ntpGetTime();
+bool ntpSetClock(uint32_t epoch);
+
+// Tasks.cpp
+#define NET_CMD_NTP     1 // Get NTP time for ntpTickTime()
+#define NET_CMD_EIBI    2 // Download EiBi schedule, see eibiRequestLoad()
+#define NET_CMD_GALGAME 3 // Run GalGame HTTP request, see galgameNetWork()
+
+typedef struct
+{
+  uint16_t freq;      // Current frequency
+  int16_t  bfo;       // Current BFO (SSB)
+  uint8_t  band;      // Current band index
+  uint8_t  mode;      // Current modulation
+  uint8_t  rssi;      // RSSI (dBuV)
+  uint8_t  snr;       // SNR (dB)
+} RadioState;
+
+void tasksInit();
+bool netRequest(uint8_t cmd);
+bool ntpTickTime();
+void radioPublishState();
+void radioGetState(RadioState *state);
 
 // Ble.cpp
 int bleDoCommand(uint8_t bleModeIdx);
@@ -4,6 +4,7 @@
 #include "Utils.h"
 #include "Menu.h"
 #include "Draw.h"
+#include "EIBI.h"
 
 //
 // Draw preferences write indicator
@@ -249,11 +250,73 @@ void drawFrequency(uint32_t freq, int x, int y, int ux, int uy, uint8_t hl)
   }
 }
 
+//
+// Draw band plan segments under the scale, walking label intervals
+// rather than looking up labels for every pixel
+//
+static void drawBandPlan(uint32_t freq, int y)
+{
+  // Band labels only cover AM frequencies
+  if(currentMode == FM) return;
+
+  // Scale offset and leftmost frequency, as in drawScale()
+  int16_t offset = (freq % 10) / 10.0 * 8;
+  uint32_t start = (freq / 10 - 20) * 10;
+
+  // Clip visible frequencies to band edges
+  const Band *band = getCurrentBand();
+  uint32_t f = max(start, (uint32_t)band->minimumFreq);
+  uint32_t end = min(start + 400, (uint32_t)band->maximumFreq);
+
+  for(uint16_t next ; f < end ; f = next)
+  {
+    uint64_t labels = bandLabelsAt(f, &next);
+    next = min((uint32_t)next, end);
+
+    if(labels)
+    {
+      int16_t x1 = (f - start) * 8 / 10 - offset;
+      int16_t x2 = (next - start) * 8 / 10 - offset;
+      spr.fillRect(x1, y, max(x2 - x1, 1), 2, TH.freq_hl);
+    }
+  }
+}
+
+//
+// Draw name of the most specific band plan label at the tuned frequency
+//
+static void drawBandName(uint32_t freq, int x, int y)
+{
+  // Band labels only cover AM frequencies
+  if(currentMode == FM) return;
+
+  uint64_t labels = bandLabelsAt(freq);
+  const BandLabel *label = NULL;
+
+  for(int j = 0 ; labels ; ++j, labels >>= 1)
+  {
+    const BandLabel *l = getBandLabel(j);
+    if((labels & 1) && (!label || l->freq_end - l->freq_start < label->freq_end - label->freq_start))
+      label = l;
+  }
+
+  if(label)
+  {
+    spr.setTextDatum(TL_DATUM);
+    spr.setTextColor(TH.freq_hl, TH.bg);
+    spr.drawString(label->name, x, y, 1);
+  }
+}
+
 //
 // Draw tuner scale
 //
 void drawScale(uint32_t freq)
 {
+  // Band plan
+  drawBandPlan(freq, 168);
+  drawBandName(freq, 2, 122);
+
   // Scale pointer
   spr.fillTriangle(156, 120, 160, 130, 164, 120, TH.scale_pointer);
   spr.drawLine(160, 130, 160, 169, TH.scale_pointer);
@@ -369,11 +432,41 @@ void drawLongStationName(const char *name, int x, int y)
   }
 }
 
+#define WATERFALL_Y      129  // Waterfall top line
+#define WATERFALL_HEIGHT  41  // Waterfall lines, one per sweep
+
+// Waterfall, kept between redraws
+static TFT_eSprite waterfall = TFT_eSprite(&tft);
+static uint32_t waterfallSweeps = 0;  // Sweeps drawn so far
+static uint32_t waterfallStart = 0;   // Leftmost frequency drawn
+static int16_t  waterfallOffset = -1; // Scale offset drawn
+static uint16_t waterfallBg = 0;      // Background color drawn
+
+//
+// Draw sweep rate, in points per second
+//
+static void drawScanRate()
+{
+  float rate = scanGetRate();
+  if(rate > 0.0)
+  {
+    char text[16];
+    sprintf(text, "%.1f pt/s", rate);
+    spr.setTextDatum(TR_DATUM);
+    spr.setTextColor(TH.scan_grid, TH.bg);
+    spr.drawString(text, 318, 130, 1);
+  }
+}
+
 //
 // Draw scan graphs
 //
 void drawScanGraphs(uint32_t freq)
 {
+  // Band plan, named after the graphs are drawn
+  uint32_t tuned = freq;
+  drawBandPlan(freq, 126);
+
   // Scale offset
   int16_t offset = (freq % 10) / 10.0 * 8;
 
@@ -385,11 +478,20 @@ void drawScanGraphs(uint32_t freq)
   uint32_t minFreq = band->minimumFreq / 10;
   uint32_t maxFreq = band->maximumFreq / 10;
 
-  for(int i=0 ; i<41 ; i++, freq++)
+  // Graph heights in pixels, one per scale tick
+  uint16_t graphFreq;
+  int count;
+  const uint8_t *rssi = scanGetGraph(false, &graphFreq, &count);
+  const uint8_t *snr  = scanGetGraph(true, &graphFreq, &count);
+  int k = (int)freq - graphFreq / SCAN_GRAPH_UNIT;
+  int16_t rssiY = 169, snrY = 169;
+
+  for(int i=0 ; i<42 ; i++, freq++, k++)
   {
     int16_t x = i * 8 - offset;
+    bool inBand = freq >= minFreq && freq <= maxFreq;
 
-    if(freq >= minFreq && freq <= maxFreq)
+    if(i<41 && inBand)
     {
       if((freq % 5) == 0) {
         for(int y=0; y<42; y+=2) {
@@ -405,18 +507,134 @@ void drawScanGraphs(uint32_t freq)
           spr.drawPixel(xd, 169-10, TH.scan_grid);
           spr.drawPixel(xd, 169-0, TH.scan_grid);
         }
-        int snr1 = 40 * scanGetSNR(freq * 10);
-        int snr2 = 40 * scanGetSNR((freq+1) * 10);
-        spr.drawLine(x, 169-snr1, x+8, 169-snr2, TH.scan_snr);
-        int rssi1 = 40 * scanGetRSSI(freq * 10);
-        int rssi2 = 40 * scanGetRSSI((freq+1) * 10);
-        spr.drawLine(x, 169-rssi1, x+8, 169-rssi2, TH.scan_rssi);
       }
     }
+
+    // Draw both curves in one pass, from the previous tick to this one
+    int16_t snrY2  = 169 - (k >= 0 && k < count? snr[k] : 0);
+    int16_t rssiY2 = 169 - (k >= 0 && k < count? rssi[k] : 0);
+    if(i && inBand && (freq-1) >= minFreq)
+    {
+      spr.drawLine(x-8, snrY, x, snrY2, TH.scan_snr);
+      spr.drawLine(x-8, rssiY, x, rssiY2, TH.scan_rssi);
+    }
+    snrY  = snrY2;
+    rssiY = rssiY2;
+  }
+
+  // Scale pointer
+  spr.fillTriangle(156, 125, 160, 130, 164, 125, TH.scale_pointer);
+  spr.drawLine(160, 130, 160, 169, TH.scale_pointer);
+
+  drawBandName(tuned, 2, 130);
+  drawScanRate();
+}
+
+//
+// Waterfall colors, from dark blue for noise to red for strong signals
+//
+static uint16_t waterfallColor(float level)
+{
+  int v = level * 1023;
+  v = v < 0? 0 : v > 1023? 1023 : v;
+
+  uint8_t seg = v >> 8, t = v & 0xFF;
+  switch(seg)
+  {
+    case 0:  return(spr.color565(0, t / 2, 64 + t / 2));     // Blue
+    case 1:  return(spr.color565(0, 128 + t / 2, 192 - t));  // Cyan-green
+    case 2:  return(spr.color565(t, 255, 0));                // Yellow
+    default: return(spr.color565(255, 255 - t, 0));          // Red
+  }
+}
+
+//
+// Draw one waterfall line from a past sweep
+//
+static void drawWaterfallLine(int y, int age, uint32_t start, int16_t offset)
+{
+  for(int x=0 ; x<320 ; x++)
+  {
+    float level = scanGetHistoryRSSI(age, start + (x + offset) * 10 / 8);
+    waterfall.drawPixel(x, y, level < 0.0? TH.bg : waterfallColor(level));
+  }
+}
+
+//
+// Draw scan waterfall, with max-hold and average traces on top. The
+// waterfall sprite is kept between redraws and scrolled down by one
+// line per sweep, only redrawn in full when the view changes.
+//
+void drawScanWaterfall(uint32_t freq)
+{
+  // Waterfall sprite is allocated once, falling back to graphs
+  if(!waterfall.created() && !waterfall.createSprite(320, WATERFALL_HEIGHT))
+  {
+    drawScanGraphs(freq);
+    return;
+  }
+
+  // Band plan, named after the graphs are drawn
+  uint32_t tuned = freq;
+  drawBandPlan(freq, 126);
+
+  // Scale offset and leftmost frequency, as in drawScale()
+  int16_t offset = (freq % 10) / 10.0 * 8;
+  uint32_t start = (freq / 10 - 20) * 10;
+
+  uint32_t sweeps = scanGetSweeps();
+  uint32_t lines = sweeps - waterfallSweeps;
+
+  if(lines >= WATERFALL_HEIGHT || start != waterfallStart ||
+     offset != waterfallOffset || TH.bg != waterfallBg)
+  {
+    // View changed, redraw all lines
+    for(int y=0 ; y<WATERFALL_HEIGHT ; y++)
+      drawWaterfallLine(y, y, start, offset);
+  }
+  else if(lines)
+  {
+    // Scroll down, drawing new sweeps on top
+    waterfall.scroll(0, lines);
+    for(int y=0 ; y<(int)lines ; y++)
+      drawWaterfallLine(y, y, start, offset);
+  }
+
+  waterfallSweeps = sweeps;
+  waterfallStart  = start;
+  waterfallOffset = offset;
+  waterfallBg     = TH.bg;
+  waterfall.pushToSprite(&spr, 0, WATERFALL_Y);
+
+  // Get band edges
+  const Band *band = getCurrentBand();
+  uint32_t minFreq = band->minimumFreq / 10;
+  uint32_t maxFreq = band->maximumFreq / 10;
+
+  // Max-hold and average traces
+  if(scanGetHistoryCount())
+  {
+    freq = freq / 10 - 20;
+    for(int i=0 ; i<41 ; i++, freq++)
+    {
+      int16_t x = i * 8 - offset;
+      if(freq < minFreq || freq >= maxFreq) continue;
+
+      int avg1 = 40 * scanGetAverage(freq * 10);
+      int avg2 = 40 * scanGetAverage((freq+1) * 10);
+      spr.drawLine(x, 169-avg1, x+8, 169-avg2, TH.scan_snr);
+      int max1 = 40 * scanGetMaxHold(freq * 10);
+      int max2 = 40 * scanGetMaxHold((freq+1) * 10);
+      spr.drawLine(x, 169-max1, x+8, 169-max2, TH.scan_rssi);
+    }
   }
+
   // Scale pointer
   spr.fillTriangle(156, 125, 160, 130, 164, 125, TH.scale_pointer);
   spr.drawLine(160, 130, 160, 169, TH.scale_pointer);
+
+  drawBandName(tuned, 2, 130);
+  drawScanRate();
 }
 
 //
@@ -429,6 +647,10 @@ void drawScreen(const char *statusLine1, const char *statusLine2)
   // Do not update the screen while tuning (if enabled)
   if(tuneHoldOff && tuning_flag) return;
 
+  // Show EiBi download status, unless given other status
+  if(!statusLine1 && !statusLine2 && (statusLine2 = eibiLoadStatus()))
+    statusLine1 = "Loading EiBi Schedule";
+
   // Clear screen buffer
   spr.fillSprite(TH.bg);
 
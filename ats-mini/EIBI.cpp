@@ -1,4 +1,6 @@
 #include "Common.h"
+#include "Storage.h"
+#include "Utils.h"
 #include "Draw.h"
 #include "EIBI.h"
 
@@ -7,8 +9,12 @@
 #include <LittleFS.h>
 #include <FS.h>
 
+#include <esp_partition.h>
+#include <esp_rom_crc.h>
+#include <rom/miniz.h>
 #include <ctype.h>
 #include <string.h>
+#include <algorithm>
 
 #define EIBI_PATH "/schedules.bin"
 #define TEMP_PATH "/schedules.tmp"
@@ -16,7 +22,7 @@
 #define EIBI_URL  "http://eibispace.de/dx/eibi.txt"
 #endif
 
-const BandLabel bandLabels[] =
+static constexpr BandLabel bandLabels[] =
 {
   {  472,   479,  "630m (CW)"     },
   {  500,   518,  "NAVTEX"        },
@@ -63,418 +69,1992 @@ const BandLabel bandLabels[] =
   {29600, 30000,  "9m BC"         }
 };
 
-// FIXME: this might be slow
+//
+// Band labels overlap, so they are looked up through elementary
+// intervals between sorted label edges, each with a bitmask of
+// labels covering it. The table is built at compile time.
+//
+#define BAND_LABEL_COUNT ITEM_COUNT(bandLabels)
+static_assert(BAND_LABEL_COUNT <= 64, "Band label masks are 64bit");
+
+struct BandPlan
+{
+  uint16_t edges[2 * BAND_LABEL_COUNT]; // Sorted unique label edges
+  uint64_t masks[2 * BAND_LABEL_COUNT]; // Labels covering edges[j]..edges[j+1]
+  size_t   count;                       // Number of edges
+};
+
+static constexpr BandPlan buildBandPlan()
+{
+  BandPlan plan = {};
+
+  // Collect unique label edges in sorted order
+  for(size_t j = 0 ; j < BAND_LABEL_COUNT ; ++j)
+    for(int n = 0 ; n < 2 ; ++n)
+    {
+      uint16_t edge = n? bandLabels[j].freq_end : bandLabels[j].freq_start;
+      size_t k = 0;
+
+      while(k < plan.count && plan.edges[k] < edge) ++k;
+      if(k < plan.count && plan.edges[k] == edge) continue;
+
+      for(size_t m = plan.count ; m > k ; --m) plan.edges[m] = plan.edges[m - 1];
+      plan.edges[k] = edge;
+      plan.count++;
+    }
+
+  // Mark labels covering each interval between edges
+  for(size_t k = 0 ; k + 1 < plan.count ; ++k)
+    for(size_t j = 0 ; j < BAND_LABEL_COUNT ; ++j)
+      if(bandLabels[j].freq_start <= plan.edges[k] && bandLabels[j].freq_end >= plan.edges[k + 1])
+        plan.masks[k] |= 1ULL << j;
+
+  return(plan);
+}
+
+static constexpr BandPlan bandPlan = buildBandPlan();
+
+const BandLabel *getBandLabel(int idx) { return(&bandLabels[idx]); }
+
+//
+// Get labels covering given frequency, as a bitmask of label indices.
+// Optionally returns the frequency where this set of labels changes.
+//
+uint64_t bandLabelsAt(uint16_t freq, uint16_t *next)
+{
+  const uint16_t *edge = std::upper_bound(bandPlan.edges, bandPlan.edges + bandPlan.count, freq);
+  size_t k = edge - bandPlan.edges;
+
+  if(next) *next = k < bandPlan.count? bandPlan.edges[k] : 0xFFFF;
+  return(k > 0 && k < bandPlan.count? bandPlan.masks[k - 1] : 0);
+}
+
+#define RECS_PATH "/schedules.rec"
+#define SORT_PATH "/schedules.srt"
+
+// Raw data partition for the compiled schedule, if present
+#define EIBI_PARTITION "eibi"
+
+static const esp_partition_t *eibiPart = NULL;
+static esp_partition_mmap_handle_t eibiMap;
+static bool eibiMapped = false;
+
+// Schedule loaded into memory (PSRAM, if available)
+static uint8_t *eibiData = NULL;
+static const uint32_t *eibiBuckets = NULL;
+static const EibiRecord *eibiRecords = NULL;
+static const uint32_t *eibiNameOffsets = NULL;
+static const uint32_t *eibiWords = NULL;
+static const char *eibiNames = NULL;
+static size_t eibiCount = 0;
+static size_t eibiNameCount = 0;
+static size_t eibiWordCount = 0;
+static size_t eibiFileSize = 0;
+static time_t eibiFileTime = 0;
+
+// Time slot index: for each EIBI_SLOT_MINUTES of the day, a bitset
+// of records that are on air at some point during that slot
+#define EIBI_SLOT_MINUTES 15
+#define EIBI_SLOTS        (24 * 60 / EIBI_SLOT_MINUTES)
+
+static uint32_t *eibiSlots = NULL;
+
+// User filter: comma separated language and target area codes, plus
+// the bitset of records passing it on eibiFilterDay (NULL = all pass)
+#define EIBI_FILTER_SIZE  32
+#define EIBI_FILTER_STALE (-2)
+
+static char filterLangs[EIBI_FILTER_SIZE] = "";
+static char filterTargets[EIBI_FILTER_SIZE] = "";
+static uint32_t *eibiFilter = NULL;
+static int eibiFilterDay = EIBI_FILTER_STALE;
+
+static void eibiDropFilter()
+{
+  free(eibiFilter);
+  eibiFilter = NULL;
+  eibiFilterDay = EIBI_FILTER_STALE;
+}
+
+// Changes whenever the schedule is dropped, invalidating the names
+// that StationSchedule entries held by callers point to
+static uint32_t eibiGen = 0;
+
+// The network task owns the schedule while downloading it, until
+// eibiLoadSchedule() clears eibiLoading. Meanwhile, loop() finds no
+// schedule and shows loadStatus, see eibiTickTime().
+static volatile bool eibiLoading = false;
+static const char * volatile loadStatus = NULL; // Status line, or NULL
+static volatile uint32_t loadSeq = 0;           // Changes with status
+static volatile int loadBytes = 0;              // Bytes downloaded
+static volatile int loadLines = 0;              // Entries parsed
+static const char loadProgress[] = "";          // Show loadBytes, loadLines
+static bool loadPending = false;                // Requested by loop()
+static uint32_t loadDoneTime = 0;               // millis() when loaded
+
+static void eibiDrop()
+{
+  eibiGen++;
+  eibiDropFilter();
+  free(eibiSlots);
+  eibiSlots = NULL;
+  if(eibiMapped) esp_partition_munmap(eibiMap);
+  else free(eibiData);
+  eibiMapped = false;
+  eibiData = NULL;
+  eibiBuckets = NULL;
+  eibiRecords = NULL;
+  eibiNameOffsets = NULL;
+  eibiWords = NULL;
+  eibiNames = NULL;
+  eibiCount = eibiNameCount = eibiWordCount = eibiFileSize = eibiFileTime = 0;
+}
+
+//
+// Get total compiled schedule size from its header
+//
+static size_t eibiDataSize(const EibiHeader *hdr)
+{
+  return(sizeof(EibiHeader)
+    + EIBI_RECORDS_SIZE(hdr->count)
+    + (EIBI_BUCKETS + 1) * sizeof(uint32_t)
+    + hdr->nameCount * sizeof(uint32_t)
+    + hdr->wordCount * sizeof(uint32_t)
+    + hdr->namesSize);
+}
+
+//
+// Check compiled schedule header against the total data size
+//
+static bool eibiValidHeader(const EibiHeader *hdr, size_t size)
+{
+  if(size < sizeof(EibiHeader)) return(false);
+  if(hdr->magic!=EIBI_MAGIC || hdr->version!=EIBI_VERSION) return(false);
+  if(hdr->recSize!=sizeof(EibiRecord) || hdr->nameCount>EIBI_MAX_NAMES) return(false);
+  if(!(hdr->flags & EIBI_SORTED)) return(false);
+
+  return(size==eibiDataSize(hdr));
+}
+
+//
+// Check if a record is on air at any time during the given slot
+//
+static bool entryInSlot(const EibiRecord *entry, int slot)
+{
+  // Check if entry applies to all hours
+  if(entry->start==EIBI_ANYTIME || entry->end==EIBI_ANYTIME) return(true);
+
+  // These are slot starting/ending times in minutes
+  int start = slot * EIBI_SLOT_MINUTES;
+  int end   = start + EIBI_SLOT_MINUTES - 1;
+
+  // Inclusive schedule overlaps the slot
+  if(entry->start <= entry->end)
+    return(entry->start <= end && entry->end >= start);
+
+  // Exclusive schedule overlaps the slot
+  return(entry->start <= end || entry->end >= start);
+}
+
+// Get number of words in a bitset with a bit per record
+static inline size_t bitWords()
+{
+  return((eibiCount + 31) / 32);
+}
+
+// Check if record is in a bitset (NULL bitset has every record)
+static inline bool inSet(const uint32_t *bits, size_t j)
+{
+  return(!bits || (bits[j / 32] & (1UL << (j % 32))));
+}
+
+//
+// Build time slot index for the loaded records. Lookups fall back
+// to checking every record if there is not enough memory for it.
+//
+static void eibiBuildSlots()
+{
+  size_t words = bitWords();
+
+  eibiSlots = words? (uint32_t *)ps_calloc(EIBI_SLOTS * words, sizeof(uint32_t)) : NULL;
+  if(!eibiSlots) return;
+
+  for(int slot = 0 ; slot < EIBI_SLOTS ; ++slot)
+  {
+    uint32_t *bits = eibiSlots + slot * words;
+    for(size_t j = 0 ; j < eibiCount ; ++j)
+      if(entryInSlot(&eibiRecords[j], slot)) bits[j / 32] |= 1UL << (j % 32);
+  }
+}
+
+// Get time slot bitset for the given time (or NULL if no index)
+static const uint32_t *slotBits(int now)
+{
+  return(eibiSlots? eibiSlots + (now / EIBI_SLOT_MINUTES % EIBI_SLOTS) * bitWords() : NULL);
+}
+
+// Get a word of the intersection of two bitsets (NULL = all set)
+static inline uint32_t bothWord(const uint32_t *bits, const uint32_t *mask, size_t w)
+{
+  return((bits? bits[w] : 0xFFFFFFFFUL) & (mask? mask[w] : 0xFFFFFFFFUL));
+}
+
+//
+// Find the first bit set in both bitsets at or after position j, one
+// word at a time. Returns eibiCount if there are none. Every record
+// is a candidate when there are no bitsets.
+//
+static size_t nextSetBit(const uint32_t *bits, const uint32_t *mask, size_t j)
+{
+  if((!bits && !mask) || j>=eibiCount) return(j<eibiCount? j : eibiCount);
+
+  size_t w = j / 32;
+  uint32_t word = bothWord(bits, mask, w) & (0xFFFFFFFFUL << (j % 32));
+
+  while(!word)
+    if(++w >= bitWords()) return(eibiCount);
+    else word = bothWord(bits, mask, w);
+
+  j = w * 32 + __builtin_ctz(word);
+  return(j<eibiCount? j : eibiCount);
+}
+
+//
+// Find the last bit set in both bitsets at or before position j, one
+// word at a time. Returns (size_t)-1 if there are none.
+//
+static size_t prevSetBit(const uint32_t *bits, const uint32_t *mask, size_t j)
+{
+  if(j==(size_t)-1) return(j);
+  if(j>=eibiCount) j = eibiCount - 1;
+  if(!bits && !mask) return(j);
+
+  size_t w = j / 32;
+  uint32_t word = bothWord(bits, mask, w) & (0xFFFFFFFFUL >> (31 - j % 32));
+
+  while(!word)
+    if(!w--) return((size_t)-1);
+    else word = bothWord(bits, mask, w);
+
+  return(w * 32 + 31 - __builtin_clz(word));
+}
+
+// Get frequency directory bucket for the given frequency
+static inline int freqBucket(uint16_t freq)
+{
+  if(freq < EIBI_BUCKET_MIN) return(0);
+  int b = (freq - EIBI_BUCKET_MIN) / EIBI_BUCKET_KHZ;
+  return(b < EIBI_BUCKETS? b : EIBI_BUCKETS - 1);
+}
+
+//
+// Find the first record with frequency at or above the given one:
+// one directory probe, then a short scan through the bucket
+//
+static size_t lowerBound(uint16_t freq)
+{
+  // Must have schedule
+  if(!eibiCount) return(0);
+
+  int b = freqBucket(freq);
+  size_t j;
+
+  for(j = eibiBuckets[b] ; j < eibiBuckets[b + 1] && eibiRecords[j].freq < freq ; ++j);
+  return(j);
+}
+
+// Find the first record with frequency above the given one
+static inline size_t upperBound(uint16_t freq)
+{
+  return(freq==0xFFFF? eibiCount : lowerBound(freq + 1));
+}
+
+//
+// Check schedule data and make it current
+//
+static bool eibiAttach(const uint8_t *data, size_t size)
+{
+  // Reject old or damaged data
+  const EibiHeader *hdr = (const EibiHeader *)data;
+  if(!eibiValidHeader(hdr, size) ||
+     hdr->crc!=esp_rom_crc32_le(0, data + sizeof(EibiHeader), size - sizeof(EibiHeader)))
+    return(false);
+
+  eibiRecords     = (const EibiRecord *)(data + sizeof(EibiHeader));
+  eibiBuckets     = (const uint32_t *)(data + sizeof(EibiHeader) + EIBI_RECORDS_SIZE(hdr->count));
+  eibiNameOffsets = eibiBuckets + EIBI_BUCKETS + 1;
+  eibiWords       = eibiNameOffsets + hdr->nameCount;
+  eibiNames       = (const char *)(eibiWords + hdr->wordCount);
+  eibiCount       = hdr->count;
+  eibiNameCount   = hdr->nameCount;
+  eibiWordCount   = hdr->wordCount;
+
+  // Index records by time of day
+  eibiBuildSlots();
+  return(true);
+}
+
+//
+// Map schedule from the raw flash partition, accessing it in place
+//
+static bool eibiReloadPartition()
+{
+  EibiHeader hdr;
+  const void *data;
+
+  // Drop old data
+  eibiDrop();
+
+  // Check header before mapping anything
+  if(esp_partition_read(eibiPart, 0, &hdr, sizeof(hdr)) != ESP_OK) return(false);
+  if(hdr.magic!=EIBI_MAGIC) return(false);
+  if(hdr.count > eibiPart->size / sizeof(EibiRecord)) return(false);
+  if(hdr.nameCount > EIBI_MAX_NAMES || hdr.namesSize > eibiPart->size) return(false);
+  if(hdr.wordCount > eibiPart->size / sizeof(uint32_t)) return(false);
+
+  size_t size = eibiDataSize(&hdr);
+  if(size > eibiPart->size) return(false);
+
+  if(esp_partition_mmap(eibiPart, 0, size, ESP_PARTITION_MMAP_DATA, &data, &eibiMap) != ESP_OK)
+    return(false);
+
+  eibiMapped = true;
+  eibiData   = (uint8_t *)data;
+
+  if(!eibiAttach(eibiData, size))
+  {
+    eibiDrop();
+    return(false);
+  }
+
+  return(true);
+}
+
+//
+// Load schedule from the flash partition or file system into memory,
+// unless the file has not changed since it was last loaded
+//
+static bool eibiReload()
+{
+  // Prefer raw partition, if we have one
+  if(eibiPart) return(eibiReloadPartition());
+
+  fs::File file = LittleFS.open(EIBI_PATH, "rb");
+
+  // No schedule file: drop whatever we have in memory
+  if(!file)
+  {
+    eibiDrop();
+    return(false);
+  }
+
+  // Nothing to do if the file has not changed
+  size_t size = file.size();
+  time_t time = file.getLastWrite();
+  if(eibiData && size==eibiFileSize && time==eibiFileTime)
+  {
+    file.close();
+    return(true);
+  }
+
+  // Drop old data
+  eibiDrop();
+
+  // Allocate memory, preferring PSRAM
+  uint8_t *data = size? (uint8_t *)ps_malloc(size) : NULL;
+  if(!data && size) data = (uint8_t *)malloc(size);
+
+  // Read the whole schedule at once
+  if(!data || file.read(data, size) != size)
+  {
+    free(data);
+    file.close();
+    return(false);
+  }
+
+  file.close();
+  eibiData = data;
+
+  if(!eibiAttach(eibiData, size))
+  {
+    eibiDrop();
+    return(false);
+  }
+
+  eibiFileSize = size;
+  eibiFileTime = time;
+  return(true);
+}
+
+void eibiInit()
+{
+  eibiPart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, EIBI_PARTITION);
+
+  // Restore user filter
+  if(prefs.begin("eibi", true, STORAGE_PARTITION))
+  {
+    prefs.getString("langs", filterLangs, sizeof(filterLangs));
+    prefs.getString("targets", filterTargets, sizeof(filterTargets));
+    prefs.end();
+  }
+
+  eibiReload();
+}
+
 bool eibiAvailable()
 {
-  return(LittleFS.exists(EIBI_PATH));
+  return(!eibiLoading && eibiCount > 0);
+}
+
+uint32_t eibiGeneration()
+{
+  return(eibiGen);
+}
+
+static const char *eibiName(uint16_t id)
+{
+  return(id<eibiNameCount? eibiNames + eibiNameOffsets[id] : "");
+}
+
+//
+// Check if any of the comma separated codes is in the comma
+// separated list (case insensitive)
+//
+static bool codesInList(const char *codes, const char *list)
+{
+  for(const char *c = codes ; *c ; c += *c==',')
+  {
+    size_t len = strcspn(c, ",");
+
+    for(const char *l = list ; *l ; l += *l==',')
+    {
+      size_t n = strcspn(l, ",");
+      if(n==len && !strncasecmp(c, l, len)) return(true);
+      l += n;
+    }
+
+    c += len;
+  }
+
+  return(false);
+}
+
+//
+// Mark names (i.e. codes) matching the filter list. Returns NULL,
+// meaning that any code matches, if the list is empty.
+//
+static uint32_t *codesMatching(const char *list)
+{
+  if(!*list) return(NULL);
+
+  uint32_t *match = (uint32_t *)calloc((eibiNameCount + 31) / 32, sizeof(uint32_t));
+  if(!match) return(NULL);
+
+  for(size_t id = 0 ; id < eibiNameCount ; ++id)
+    if(codesInList(eibiName(id), list)) match[id / 32] |= 1UL << (id % 32);
+
+  return(match);
+}
+
+// Check if a record code is marked (codes not given only match "any")
+static inline bool codeMatches(const uint32_t *match, const char *list, uint16_t id)
+{
+  if(!*list) return(true);
+  return(match && id!=EIBI_NO_CODE && (match[id / 32] & (1UL << (id % 32))));
+}
+
+//
+// Build bitset of records passing the user filter and broadcasting
+// on the given weekday (-1 = any day). Lookups only go through the
+// records in this bitset, along with the time slot bitset.
+//
+static void eibiBuildFilter(int day)
+{
+  eibiDropFilter();
+  eibiFilterDay = day;
+
+  // No filter: every record passes
+  if(!eibiCount || (day<0 && !*filterLangs && !*filterTargets)) return;
+
+  uint32_t *langs   = codesMatching(filterLangs);
+  uint32_t *targets = codesMatching(filterTargets);
+  uint8_t dayMask   = day<0? EIBI_DAILY : EIBI_DAY_MON << day;
+
+  eibiFilter = (uint32_t *)ps_calloc(bitWords(), sizeof(uint32_t));
+  if(eibiFilter)
+  {
+    for(size_t j = 0 ; j < eibiCount ; ++j)
+    {
+      const EibiRecord *rec = &eibiRecords[j];
+      if((rec->days & dayMask) &&
+         codeMatches(langs, filterLangs, rec->lang) &&
+         codeMatches(targets, filterTargets, rec->target))
+        eibiFilter[j / 32] |= 1UL << (j % 32);
+    }
+  }
+
+  free(langs);
+  free(targets);
+}
+
+//
+// Get bitset of records passing the user filter today (NULL if
+// all do), rebuilding it when the UTC day changes
+//
+static const uint32_t *filterBits()
+{
+  int day = clockGetWeekday();
+  if(day!=eibiFilterDay) eibiBuildFilter(day);
+  return(eibiFilter);
+}
+
+//
+// Set user filter to comma separated language and target area codes
+// (NULL or empty = any), saving it to preferences
+//
+void eibiSetFilter(const char *langs, const char *targets)
+{
+  snprintf(filterLangs, sizeof(filterLangs), "%s", langs? langs : "");
+  snprintf(filterTargets, sizeof(filterTargets), "%s", targets? targets : "");
+
+  // A new schedule comes with no filter anyway
+  if(!eibiLoading) eibiDropFilter();
+
+  if(prefs.begin("eibi", false, STORAGE_PARTITION))
+  {
+    prefs.putString("langs", filterLangs);
+    prefs.putString("targets", filterTargets);
+    prefs.end();
+  }
+}
+
+const char *eibiGetFilter(bool target)
+{
+  return(target? filterTargets : filterLangs);
+}
+
+//
+// Convert compiled record into the StationSchedule returned by the API
+//
+static const StationSchedule *eibiEntry(const EibiRecord *rec)
+{
+  // Will return this static entry
+  static StationSchedule entry;
+
+  entry.freq   = rec->freq;
+  entry.days   = rec->days;
+  entry.source = rec->source;
+  entry.name   = eibiName(rec->name);
+  entry.lang   = eibiName(rec->lang);
+  entry.target = eibiName(rec->target);
+
+  if(rec->start==EIBI_ANYTIME || rec->end==EIBI_ANYTIME)
+  {
+    entry.start_h = entry.end_h = -1;
+    entry.start_m = entry.end_m = 0;
+  }
+  else
+  {
+    entry.start_h = rec->start / 60;
+    entry.start_m = rec->start % 60;
+    entry.end_h   = rec->end / 60;
+    entry.end_m   = rec->end % 60;
+  }
+
+  return(&entry);
+}
+
+static bool entryIsNow(const EibiRecord *entry, int now)
+{
+  // Check if entry applies to all hours
+  if(entry->start==EIBI_ANYTIME || entry->end==EIBI_ANYTIME) return(true);
+
+  // These are starting/ending times in minutes
+  int start = entry->start;
+  int end   = entry->end;
+
+  // Check for inclusive schedule
+  if(start <= end && now >= start && now <= end) return(true);
+
+  // Check for exclusive schedule
+  if(start > end && (now >= start || now <= end)) return(true);
+
+  // Nope
+  return(false);
+}
+
+// Offsets reported to the callers are in bytes, as if they were
+// file positions, to keep the API unchanged
+static inline size_t toOffset(size_t idx) { return(idx * sizeof(EibiRecord)); }
+static inline size_t fromOffset(size_t offset) { return(offset / sizeof(EibiRecord)); }
+
+const StationSchedule *eibiNext(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset)
+{
+  // Must have valid offset
+  if(!offset || eibiLoading) return(NULL);
+
+  int now = hour * 60 + minute;
+  const uint32_t *bits = slotBits(now);
+  const uint32_t *mask = filterBits();
+
+  // Start with the given offset or the first entry above frequency
+  size_t j = *offset==(size_t)-1? upperBound(freq) : fromOffset(*offset);
+
+  // Only look at entries passing the filter and on air during the current time slot
+  for(j = nextSetBit(bits, mask, j) ; j < eibiCount ; j = nextSetBit(bits, mask, j + 1))
+  {
+    if((eibiRecords[j].freq>freq) && entryIsNow(&eibiRecords[j], now))
+    {
+      *offset = toOffset(j);
+      return(eibiEntry(&eibiRecords[j]));
+    }
+  }
+
+  return(NULL);
+}
+
+const StationSchedule *eibiPrev(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset)
+{
+  // Must have valid offset
+  if(!offset || !eibiCount || eibiLoading) return(NULL);
+
+  int now = hour * 60 + minute;
+  const uint32_t *bits = slotBits(now);
+  const uint32_t *mask = filterBits();
+
+  // Start with the given offset or the last entry below frequency
+  size_t j;
+  if(*offset!=(size_t)-1) j = fromOffset(*offset);
+  else if(!(j = lowerBound(freq))) return(NULL);
+  else j--;
+
+  // Only look at entries passing the filter and on air during the current time slot
+  for(j = prevSetBit(bits, mask, j) ; j != (size_t)-1 ; j = j? prevSetBit(bits, mask, j - 1) : (size_t)-1)
+  {
+    if((eibiRecords[j].freq<freq) && entryIsNow(&eibiRecords[j], now))
+    {
+      *offset = toOffset(j);
+      return(eibiEntry(&eibiRecords[j]));
+    }
+  }
+
+  return(NULL);
+}
+
+const StationSchedule *eibiAtSameFreq(uint8_t hour, uint8_t minute, size_t *offset, bool same)
+{
+  // Must have valid offset
+  if(!offset || eibiLoading) return(NULL);
+
+  // Offset must point to an existing entry
+  size_t j = fromOffset(*offset);
+  if(j>=eibiCount) return(NULL);
+
+  const EibiRecord *e0 = &eibiRecords[j];
+  const uint32_t *mask = filterBits();
+  int now = hour * 60 + minute;
+
+  if(same && inSet(mask, j) && entryIsNow(e0, now)) return(eibiEntry(e0));
+
+  for(++j ; j<eibiCount && eibiRecords[j].freq==e0->freq ; ++j)
+  {
+    if(inSet(mask, j) && entryIsNow(&eibiRecords[j], now))
+    {
+      *offset = toOffset(j);
+      return(eibiEntry(&eibiRecords[j]));
+    }
+  }
+
+  return(NULL);
+}
+
+const StationSchedule *eibiLookup(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset)
+{
+  // Must have schedule
+  if(!eibiCount || eibiLoading) return(NULL);
+
+  // Find the first entry with given frequency
+  size_t left = lowerBound(freq);
+
+  // Save current offset, correcting for schedule size
+  if(offset) *offset = toOffset(left<eibiCount? left : eibiCount-1);
+
+  // This is our current time in minutes
+  int now = hour * 60 + minute;
+  const uint32_t *mask = filterBits();
+
+  // Look through entries with matching frequency
+  for(size_t j = left ; j<eibiCount && eibiRecords[j].freq==freq ; ++j)
+  {
+    // Report offset within the schedule
+    if(offset) *offset = toOffset(j);
+
+    // Match filter and time
+    if(inSet(mask, j) && entryIsNow(&eibiRecords[j], now)) return(eibiEntry(&eibiRecords[j]));
+  }
+
+  // Not found
+  return(NULL);
+}
+
+// Get number of minutes from now until the given time of day
+static inline int minutesUntil(int now, int time)
+{
+  int delta = (time - now + 24 * 60) % (24 * 60);
+  return(delta? delta : 24 * 60);
+}
+
+//
+// Get number of minutes for which eibiLookup() result at the given
+// frequency remains the same, i.e. until the next start or end time
+// of any entry at that frequency, or until the end of the UTC day
+// if any entry is not on air daily. Returns 0 if several entries are
+// on air at once, since callers cycle through them.
+//
+int eibiValidFor(uint16_t freq, uint8_t hour, uint8_t minute)
+{
+  // Same as no schedule, eibiTickTime() looks up again once loaded
+  if(eibiLoading) return(24 * 60);
+
+  const uint32_t *mask = filterBits();
+  int now = hour * 60 + minute;
+  int result = 24 * 60;
+  int onAir = 0;
+
+  for(size_t j = lowerBound(freq) ; j<eibiCount && eibiRecords[j].freq==freq ; ++j)
+  {
+    const EibiRecord *entry = &eibiRecords[j];
+
+    // Filter changes with the weekday
+    if(entry->days!=EIBI_DAILY && eibiFilterDay>=0) result = min(result, 24 * 60 - now);
+
+    // Only consider entries passing the filter
+    if(!inSet(mask, j)) continue;
+
+    // Count entries currently on air
+    if(entryIsNow(entry, now) && ++onAir > 1) return(0);
+
+    // All-day entries never change
+    if(entry->start==EIBI_ANYTIME || entry->end==EIBI_ANYTIME) continue;
+
+    // Entries start at their starting minute and end after their ending minute
+    result = min(result, minutesUntil(now, entry->start));
+    result = min(result, minutesUntil(now, (entry->end + 1) % (24 * 60)));
+  }
+
+  return(result);
+}
+
+// Get ID of the name containing given string table offset
+static size_t eibiNameAt(uint32_t offset)
+{
+  const uint32_t *p = std::upper_bound(eibiNameOffsets, eibiNameOffsets + eibiNameCount, offset);
+  return(p - eibiNameOffsets - 1);
+}
+
+// Get number of minutes an entry remains on air
+static int entryRemaining(const EibiRecord *entry, int now)
+{
+  if(entry->start==EIBI_ANYTIME || entry->end==EIBI_ANYTIME) return(24 * 60);
+  return(minutesUntil(now, (entry->end + 1) % (24 * 60)));
+}
+
+//
+// Find entries on air now for stations with a word in their name
+// starting with the query (case insensitive). Results are ranked by
+// the time they remain on air, longest first. Returns the number of
+// results.
+//
+size_t eibiFind(const char *query, uint8_t hour, uint8_t minute, StationSchedule *results, size_t maxResults)
+{
+  size_t len = strlen(query);
+  size_t count = 0;
+
+  // Must have schedule and query
+  if(!eibiWordCount || !len || !maxResults || eibiLoading) return(0);
+
+  // Binary search for the first word matching query
+  size_t left  = 0;
+  size_t right = eibiWordCount;
+
+  while(left < right)
+  {
+    size_t mid = (left + right) / 2;
+    if(strncasecmp(eibiNames + eibiWords[mid], query, len) < 0) left = mid + 1; else right = mid;
+  }
+
+  if(left>=eibiWordCount || strncasecmp(eibiNames + eibiWords[left], query, len)) return(0);
+
+  // Mark names with matching words
+  uint32_t *match = (uint32_t *)calloc((eibiNameCount + 31) / 32, sizeof(uint32_t));
+  uint16_t *ranks = (uint16_t *)malloc(maxResults * sizeof(uint16_t));
+  if(!match || !ranks)
+  {
+    free(match);
+    free(ranks);
+    return(0);
+  }
+
+  for(size_t j = left ; j<eibiWordCount && !strncasecmp(eibiNames + eibiWords[j], query, len) ; ++j)
+  {
+    size_t id = eibiNameAt(eibiWords[j]);
+    match[id / 32] |= 1UL << (id % 32);
+  }
+
+  // Go through entries passing the filter and on air during the current time slot
+  int now = hour * 60 + minute;
+  const uint32_t *bits = slotBits(now);
+  const uint32_t *mask = filterBits();
+
+  for(size_t j = nextSetBit(bits, mask, 0) ; j < eibiCount ; j = nextSetBit(bits, mask, j + 1))
+  {
+    const EibiRecord *entry = &eibiRecords[j];
+    uint16_t id = entry->name;
+
+    if(!(match[id / 32] & (1UL << (id % 32))) || !entryIsNow(entry, now)) continue;
+
+    // Insert result by rank, dropping the lowest ranked one if full
+    int rank = entryRemaining(entry, now);
+    size_t k = count<maxResults? count++ : maxResults;
+    for( ; k>0 && ranks[k - 1]<rank ; --k)
+      if(k<maxResults)
+      {
+        ranks[k]   = ranks[k - 1];
+        results[k] = results[k - 1];
+      }
+
+    if(k<maxResults)
+    {
+      ranks[k]   = rank;
+      results[k] = *eibiEntry(entry);
+    }
+  }
+
+  free(match);
+  free(ranks);
+  return(count);
+}
+
+//
+// Unique station names collected while loading the schedule
+//
+#define NAME_HASH_SIZE 0x10000  // Must be a power of two > EIBI_MAX_NAMES
+
+static struct
+{
+  char     *text;       // Zero-terminated names
+  size_t    size;       // Bytes used in text[]
+  size_t    capacity;   // Bytes allocated for text[]
+  uint32_t *offsets;    // Name offsets in text[]
+  uint32_t  count;      // Number of names
+  uint16_t *hash;       // Open addressing hash of name IDs
+  uint32_t *stations;   // Bitset of IDs used as station names
+} names;
+
+#define NAME_BITS_SIZE (((EIBI_MAX_NAMES + 31) / 32) * sizeof(uint32_t))
+
+static void namesFree()
+{
+  free(names.text);
+  free(names.offsets);
+  free(names.hash);
+  free(names.stations);
+  memset(&names, 0, sizeof(names));
+}
+
+static bool namesInit()
+{
+  namesFree();
+
+  names.offsets = (uint32_t *)ps_malloc(EIBI_MAX_NAMES * sizeof(uint32_t));
+  names.hash    = (uint16_t *)ps_malloc(NAME_HASH_SIZE * sizeof(uint16_t));
+  names.stations = (uint32_t *)ps_malloc(NAME_BITS_SIZE);
+  if(!names.offsets || !names.hash || !names.stations)
+  {
+    namesFree();
+    return(false);
+  }
+
+  memset(names.hash, 0xFF, NAME_HASH_SIZE * sizeof(uint16_t));
+  memset(names.stations, 0, NAME_BITS_SIZE);
+  return(true);
+}
+
+//
+// Return ID of the given name, adding it to the table if needed
+//
+static int namesIntern(const char *name)
+{
+  // FNV-1a hash
+  uint32_t h = 2166136261u;
+  for(const char *p = name ; *p ; ++p) h = (h ^ (uint8_t)*p) * 16777619u;
+
+  // Look for the name, stopping at the first empty slot
+  for(h &= NAME_HASH_SIZE - 1 ; names.hash[h]!=0xFFFF ; h = (h + 1) & (NAME_HASH_SIZE - 1))
+    if(!strcmp(names.text + names.offsets[names.hash[h]], name))
+      return(names.hash[h]);
+
+  // Check if there is space for a new name
+  size_t len = strlen(name) + 1;
+  if(names.count >= EIBI_MAX_NAMES) return(-1);
+  if(names.size + len > names.capacity)
+  {
+    size_t capacity = names.capacity? names.capacity * 2 : 16384;
+    char *text = (char *)ps_realloc(names.text, capacity);
+    if(!text) return(-1);
+    names.text = text;
+    names.capacity = capacity;
+  }
+
+  // Add new name
+  memcpy(names.text + names.size, name, len);
+  names.offsets[names.count] = names.size;
+  names.hash[h] = names.count;
+  names.size += len;
+  return(names.count++);
+}
+
+char replace_accented_char(char c)
+{
+  switch((unsigned char)c)
+  {
+    // Lowercase vowels with accents
+    case 0xE1: case 0xE0: case 0xE2: case 0xE3: case 0xE4: return 'a'; // á, à, â, ã, ä
+    case 0xE9: case 0xE8: case 0xEA: case 0xEB: return 'e';             // é, è, ê, ë
+    case 0xED: case 0xEC: case 0xEE: case 0xEF: return 'i';            // í, ì, î, ï
+    case 0xF3: case 0xF2: case 0xF4: case 0xF5: case 0xF6: return 'o';  // ó, ò, ô, õ, ö
+    case 0xFA: case 0xF9: case 0xFB: case 0xFC: return 'u';             // ú, ù, û, ü
+    // Uppercase vowels with accents
+    case 0xC1: case 0xC0: case 0xC2: case 0xC3: case 0xC4: return 'A';  // Á, À, Â, Ã, Ä
+    case 0xC9: case 0xC8: case 0xCA: case 0xCB: return 'E';             // É, È, Ê, Ë
+    case 0xCD: case 0xCC: case 0xCE: case 0xCF: return 'I';             // Í, Ì, Î, Ï
+    case 0xD3: case 0xD2: case 0xD4: case 0xD5: case 0xD6: return 'O';  // Ó, Ò, Ô, Õ, Ö
+    case 0xDA: case 0xD9: case 0xDB: case 0xDC: return 'U';             // Ú, Ù, Û, Ü
+    // Other special chars
+    case 0xF1: return 'n';  // ñ
+    case 0xD1: return 'N';  // Ñ
+    case 0xE7: return 'c';  // ç
+    case 0xC7: return 'C';  // Ç
+    default: return c;      // No change
+  }
+}
+
+//
+// EiBi lines have fixed columns: frequency, time, days, ITU country,
+// station name, language, target area
+//
+#define COL_FREQ   0
+#define COL_TIME   14
+#define COL_DAYS   23
+#define COL_ITU    29
+#define COL_NAME   34
+#define LEN_NAME   24
+#define COL_LANG   58
+#define LEN_LANG   5
+#define COL_TARGET 63
+#define LEN_TARGET 5
+
+//
+// Copy a column of up to given width, removing leading and trailing
+// white space and replacing accented characters. Returns its length.
+//
+static size_t eibiColumn(const char *line, size_t len, size_t col, size_t width, char *out, size_t outSize)
+{
+  const char *p, *t;
+
+  // Column may be missing or cut short
+  p = line + (col < len? col : len);
+  t = line + (col + width < len? col + width : len);
+
+  // Remove leading and trailing white space
+  for( ; p<t && (*p==' ' || *p=='\t') ; ++p);
+  for( ; t>p && (t[-1]==' ' || t[-1]=='\t') ; --t);
+
+  // Copy text, replacing accented characters
+  for(len = 0 ; p<t && len<outSize-1 ; ++p)
+    out[len++] = replace_accented_char(*p);
+  out[len] = '\0';
+
+  return(len);
+}
+
+//
+// Parse weekdays: blank (daily), digits ("1245", 1 = Monday), or
+// day names with lists and ranges ("Mo-Fr", "Sa,Su"). Irregular
+// schedules ("irr", "alt", dates) are assumed to be on any day.
+//
+static uint8_t eibiParseDays(const char *days)
+{
+  static const char *dayNames[] = { "Mo", "Tu", "We", "Th", "Fr", "Sa", "Su" };
+  uint8_t result = 0;
+  int last = -1;
+  bool range = false;
+
+  for(const char *p = days ; *p ; )
+  {
+    int day = -1;
+
+    if(*p>='1' && *p<='7')
+      day = *p++ - '1';
+    else if(*p=='-' && last>=0)
+    {
+      range = true;
+      ++p;
+      continue;
+    }
+    else if(*p==',')
+    {
+      ++p;
+      continue;
+    }
+    else
+    {
+      for(int j = 0 ; j < 7 && day < 0 ; ++j)
+        if(!strncmp(p, dayNames[j], 2)) day = j;
+      if(day < 0) return(EIBI_DAILY);
+      p += 2;
+    }
+
+    // Ranges may wrap around the week, as in "Sa-Mo"
+    for(int j = range? (last + 1) % 7 : day ; ; j = (j + 1) % 7)
+    {
+      result |= EIBI_DAY_MON << j;
+      if(j==day) break;
+    }
+
+    last  = day;
+    range = false;
+  }
+
+  return(result? result : EIBI_DAILY);
+}
+
+static bool eibiParseLine(const char *line, size_t len, EibiRecord &entry, char *name, size_t nameSize, char *lang, char *target)
+{
+  char buf[16];
+
+  // Must have frequency, time and days columns
+  if(len < COL_NAME) return(false);
+
+  // Parse frequency
+  memcpy(buf, line + COL_FREQ, COL_TIME - COL_FREQ);
+  buf[COL_TIME - COL_FREQ] = '\0';
+  entry.freq = (uint16_t)atof(buf);
+  if(!entry.freq) return(false);
+
+  // Parse time
+  int sh, sm, eh, em;
+  memcpy(buf, line + COL_TIME, COL_DAYS - COL_TIME);
+  buf[COL_DAYS - COL_TIME] = '\0';
+  if(sscanf(buf, "%2d%2d-%2d%2d", &sh, &sm, &eh, &em) != 4) return(false);
+  entry.start = sh<0? EIBI_ANYTIME : sh * 60 + sm;
+  entry.end   = eh<0? EIBI_ANYTIME : eh * 60 + em;
+
+  // Parse weekdays
+  eibiColumn(line, len, COL_DAYS, COL_ITU - COL_DAYS, buf, sizeof(buf));
+  entry.days = eibiParseDays(buf);
+  entry.source = 0;
+
+  // Remove jammers
+  if(memmem(line + COL_NAME, min(len - COL_NAME, (size_t)LEN_NAME), "Jammer", 6)) return(false);
+
+  // Get station name, language and target area
+  eibiColumn(line, len, COL_NAME, LEN_NAME, name, nameSize);
+  eibiColumn(line, len, COL_LANG, LEN_LANG, lang, LEN_LANG + 1);
+  eibiColumn(line, len, COL_TARGET, LEN_TARGET, target, LEN_TARGET + 1);
+
+  // Done
+  return(true);
+}
+
+//
+// Schedule records are ordered by frequency, then by start time
+//
+static bool recordLess(const EibiRecord &a, const EibiRecord &b)
+{
+  if(a.freq!=b.freq) return(a.freq < b.freq);
+  if(a.start!=b.start) return(a.start < b.start);
+  return(a.end < b.end);
+}
+
+//
+// External sort buffers: records are sorted in EIBI_RUN_SIZE runs,
+// then merged EIBI_MERGE_WAYS runs at a time, buffering EIBI_MERGE_BUF
+// records from each run
+//
+#define EIBI_RUN_SIZE     4096
+#define EIBI_MERGE_WAYS   8
+#define EIBI_MERGE_BUF    64
+
+struct MergeRun
+{
+  uint32_t pos;         // Next record to read from file
+  uint32_t end;         // End of this run
+  uint16_t next;        // Next record in buf[]
+  uint16_t count;       // Records in buf[]
+  EibiRecord buf[EIBI_MERGE_BUF];
+};
+
+// Get current record of a run, refilling its buffer as needed
+static const EibiRecord *mergeHead(fs::File &src, MergeRun &run)
+{
+  if(run.next >= run.count)
+  {
+    if(run.pos >= run.end) return(NULL);
+    uint32_t n = run.end - run.pos < EIBI_MERGE_BUF? run.end - run.pos : EIBI_MERGE_BUF;
+    if(!src.seek(run.pos * sizeof(EibiRecord), fs::SeekSet)) return(NULL);
+    if(src.read((uint8_t *)run.buf, n * sizeof(EibiRecord)) != n * sizeof(EibiRecord)) return(NULL);
+    run.pos  += n;
+    run.next  = 0;
+    run.count = n;
+  }
+
+  return(&run.buf[run.next]);
 }
 
-static bool entryIsNow(const StationSchedule *entry, int now)
+//
+// Merge runs of runLen records from src into runs of
+// runLen * EIBI_MERGE_WAYS records in dst
+//
+static bool eibiMergePass(fs::File &src, fs::File &dst, uint32_t count, uint32_t runLen, MergeRun *runs, EibiRecord *out)
 {
-  // Check if entry applies to all hours
-  if(entry->start_h < 0 || entry->end_h < 0) return(true);
+  size_t outCnt = 0;
 
-  // These are starting/ending times in minutes
-  int start = entry->start_h * 60 + entry->start_m;
-  int end   = entry->end_h * 60 + entry->end_m;
+  for(uint32_t group = 0 ; group < count ; group += runLen * EIBI_MERGE_WAYS)
+  {
+    int ways;
 
-  // Check for inclusive schedule
-  if(start <= end && now >= start && now <= end) return(true);
+    // Set up runs in this group
+    for(ways = 0 ; ways < EIBI_MERGE_WAYS && group + ways * runLen < count ; ++ways)
+    {
+      runs[ways].pos   = group + ways * runLen;
+      runs[ways].end   = runs[ways].pos + runLen < count? runs[ways].pos + runLen : count;
+      runs[ways].next  = runs[ways].count = 0;
+    }
 
-  // Check for exclusive schedule
-  if(start > end && (now >= start || now <= end)) return(true);
+    // Repeatedly take the smallest head record
+    for(uint32_t n = group ; n < count && n < group + runLen * ways ; ++n)
+    {
+      const EibiRecord *min = NULL;
+      int minRun = -1;
 
-  // Nope
-  return(false);
-}
+      for(int j = 0 ; j < ways ; ++j)
+      {
+        const EibiRecord *head = mergeHead(src, runs[j]);
+        if(head && (!min || recordLess(*head, *min))) { min = head; minRun = j; }
+      }
 
-const StationSchedule *eibiNext(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset)
-{
-  // Will return this static entry
-  static StationSchedule entry;
+      // Ran out of data prematurely
+      if(!min) return(false);
 
-  // Must have valid offset
-  if(!offset) return(NULL);
+      out[outCnt++] = *min;
+      runs[minRun].next++;
 
-  // If no valid offset yet, find some
-  if(*offset==(size_t)-1) eibiLookup(freq, hour, minute, offset);
+      // Write out a full batch of records
+      if(outCnt >= EIBI_MERGE_BUF)
+      {
+        if(dst.write((uint8_t *)out, outCnt * sizeof(EibiRecord)) != outCnt * sizeof(EibiRecord))
+          return(false);
+        outCnt = 0;
+      }
+    }
+  }
 
-  // Open file with EIBI data
-  fs::File file = LittleFS.open(EIBI_PATH, "rb");
-  if(!file) return(NULL);
+  return(dst.write((uint8_t *)out, outCnt * sizeof(EibiRecord)) == outCnt * sizeof(EibiRecord));
+}
 
-  StationSchedule *result = NULL;
-  int now = hour * 60 + minute;
+//
+// Sort records in the given file using bounded memory. The sorted
+// records may end up in a different file, which replaces recs.
+//
+static bool eibiSortRecords(fs::File &recs, uint32_t count)
+{
+  EibiRecord *buf = (EibiRecord *)ps_malloc(EIBI_RUN_SIZE * sizeof(EibiRecord));
+  if(!buf) return(false);
 
-  // Go to the starting offset
-  if(!file.seek(*offset, fs::SeekSet))
+  // Sort each run in memory, writing it back in place
+  bool ok = true;
+  for(uint32_t pos = 0 ; ok && pos < count ; pos += EIBI_RUN_SIZE)
   {
-    file.close();
-    return(NULL);
+    size_t n = (count - pos < EIBI_RUN_SIZE? count - pos : EIBI_RUN_SIZE) * sizeof(EibiRecord);
+    ok = recs.seek(pos * sizeof(EibiRecord), fs::SeekSet) && recs.read((uint8_t *)buf, n) == n;
+    if(ok) std::sort(buf, buf + n / sizeof(EibiRecord), recordLess);
+    ok = ok && recs.seek(pos * sizeof(EibiRecord), fs::SeekSet) && recs.write((uint8_t *)buf, n) == n;
   }
 
-  while(file.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry))
+  free(buf);
+
+  // Merge runs, going back and forth between two files
+  MergeRun *runs = (MergeRun *)malloc(EIBI_MERGE_WAYS * sizeof(MergeRun));
+  EibiRecord *out = (EibiRecord *)malloc(EIBI_MERGE_BUF * sizeof(EibiRecord));
+  const char *paths[2] = { RECS_PATH, SORT_PATH };
+  int cur = 0;
+
+  ok = ok && runs && out;
+  for(uint32_t runLen = EIBI_RUN_SIZE ; ok && runLen < count ; runLen *= EIBI_MERGE_WAYS)
   {
-    if((entry.freq>freq) && entryIsNow(&entry, now))
-    {
-      *offset = file.position() - sizeof(entry);
-      result = &entry;
-      break;
-    }
+    fs::File dst = LittleFS.open(paths[cur ^ 1], "w+");
+    ok = dst && eibiMergePass(recs, dst, count, runLen, runs, out);
+    recs.close();
+    LittleFS.remove(paths[cur]);
+    recs = dst;
+    cur ^= 1;
   }
 
-  file.close();
-  return(result);
+  free(runs);
+  free(out);
+  return(ok && recs);
 }
 
-const StationSchedule *eibiPrev(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset)
+//
+// Verify that records are in order, fill frequency directory,
+// and compute CRC32 of the records
+//
+static bool eibiVerifyRecords(fs::File &recs, uint32_t count, uint32_t *buckets, uint32_t &crc)
 {
-  // Will return this static entry
-  static StationSchedule entry;
-
-  // Must have valid offset
-  if(!offset) return(NULL);
-
-  // If no valid offset yet, find some
-  if(*offset==(size_t)-1) eibiLookup(freq, hour, minute, offset);
+  EibiRecord buf[EIBI_MERGE_BUF];
+  EibiRecord last = { 0, 0, 0, 0, 0, 0, 0, 0 };
 
-  // Open file with EIBI data
-  fs::File file = LittleFS.open(EIBI_PATH, "rb");
-  if(!file) return(NULL);
+  // Buckets with no records point at the next record (or the end)
+  for(int b = 0 ; b <= EIBI_BUCKETS ; ++b) buckets[b] = count;
 
-  StationSchedule *result = NULL;
-  int now = hour * 60 + minute;
+  crc = 0;
+  if(!recs.seek(0, fs::SeekSet)) return(false);
 
-  for(size_t pos = *offset; file.seek(pos, fs::SeekSet) ; pos -= sizeof(entry))
+  for(uint32_t pos = 0 ; pos < count ; )
   {
-    if(file.read((uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) break;
+    size_t n = count - pos < EIBI_MERGE_BUF? count - pos : EIBI_MERGE_BUF;
+    if(recs.read((uint8_t *)buf, n * sizeof(EibiRecord)) != n * sizeof(EibiRecord))
+      return(false);
 
-    if((entry.freq<freq) && entryIsNow(&entry, now))
+    for(size_t j = 0 ; j < n ; last = buf[j++])
     {
-      *offset = pos;
-      result = &entry;
-      break;
+      if(recordLess(buf[j], last) || buf[j].name >= names.count) return(false);
+      if(buf[j].lang!=EIBI_NO_CODE && buf[j].lang >= names.count) return(false);
+      if(buf[j].target!=EIBI_NO_CODE && buf[j].target >= names.count) return(false);
+
+      // Point empty buckets up to this record's bucket at this record
+      for(int b = freqBucket(buf[j].freq) ; b >= 0 && buckets[b] == count ; --b)
+        buckets[b] = pos + j;
     }
+
+    crc = esp_rom_crc32_le(crc, (uint8_t *)buf, n * sizeof(EibiRecord));
+    pos += n;
   }
 
-  file.close();
-  return(result);
+  return(true);
 }
 
-const StationSchedule *eibiAtSameFreq(uint8_t hour, uint8_t minute, size_t *offset, bool same)
+//
+// Compiled schedule output, going either to a file or to the raw
+// flash partition
+//
+static fs::File outFile;
+static size_t outPos;
+
+static bool outWrite(const void *data, size_t size)
 {
-  // Will return this static entry
-  static StationSchedule entry;
+  bool ok = eibiPart?
+    esp_partition_write(eibiPart, outPos, data, size) == ESP_OK :
+    outFile.write((const uint8_t *)data, size) == size;
 
-  // Must have valid offset
-  if(!offset) return(NULL);
+  outPos += size;
+  return(ok);
+}
 
-  // Open file with EIBI data
-  fs::File file = LittleFS.open(EIBI_PATH, "rb");
-  if(!file) return(NULL);
+//
+// Check if a word starts at the given offset into collected names
+//
+static inline bool namesWordAt(size_t j)
+{
+  return(isalnum((uint8_t)names.text[j]) && (!j || !isalnum((uint8_t)names.text[j - 1])));
+}
+
+static inline bool namesIsStation(uint32_t id)
+{
+  return(names.stations[id / 32] & (1UL << (id % 32)));
+}
+
+//
+// Build an index of words in collected station names, sorted by the
+// text starting at each word, for prefix searches by eibiFind().
+// Language and target codes share the name table, but are not
+// indexed, so that searches do not match them.
+//
+static uint32_t *namesBuildWords(uint32_t *wordCount)
+{
+  uint32_t count = 0;
+
+  // Count words first
+  for(uint32_t id = 0 ; id < names.count ; ++id)
+    if(namesIsStation(id))
+      for(size_t j = names.offsets[id] ; names.text[j] ; ++j)
+        count += namesWordAt(j);
 
-  // Read current entry to get frequency
-  StationSchedule e0;
-  if(!file.seek(*offset, fs::SeekSet) || file.read((uint8_t*)&e0, sizeof(e0)) != sizeof(e0))
+  uint32_t *words = (uint32_t *)ps_malloc((count? count : 1) * sizeof(uint32_t));
+  if(!words) return(NULL);
+
+  for(uint32_t id = 0, n = 0 ; id < names.count ; ++id)
+    if(namesIsStation(id))
+      for(size_t j = names.offsets[id] ; names.text[j] ; ++j)
+        if(namesWordAt(j)) words[n++] = j;
+
+  std::sort(words, words + count, [](uint32_t a, uint32_t b) {
+    return(strcasecmp(names.text + a, names.text + b) < 0);
+  });
+
+  *wordCount = count;
+  return(words);
+}
+
+//
+// Write compiled schedule (header, records, names) from the
+// sorted temporary records file and the collected names
+//
+static bool eibiWriteSchedule(const char *path, fs::File &recs, uint32_t count)
+{
+  static const uint8_t padding[4] = { 0 };
+  size_t padSize = EIBI_RECORDS_SIZE(count) - count * sizeof(EibiRecord);
+  EibiHeader hdr;
+  uint32_t buckets[EIBI_BUCKETS + 1];
+
+  // Check record order
+  if(!eibiVerifyRecords(recs, count, buckets, hdr.crc)) return(false);
+
+  // Index words in names
+  uint32_t *words = namesBuildWords(&hdr.wordCount);
+  if(!words) return(false);
+
+  // Compute checksum over all data
+  hdr.crc = esp_rom_crc32_le(hdr.crc, padding, padSize);
+  hdr.crc = esp_rom_crc32_le(hdr.crc, (uint8_t *)buckets, sizeof(buckets));
+  hdr.crc = esp_rom_crc32_le(hdr.crc, (uint8_t *)names.offsets, names.count * sizeof(uint32_t));
+  hdr.crc = esp_rom_crc32_le(hdr.crc, (uint8_t *)words, hdr.wordCount * sizeof(uint32_t));
+  hdr.crc = esp_rom_crc32_le(hdr.crc, (uint8_t *)names.text, names.size);
+
+  hdr.magic     = EIBI_MAGIC;
+  hdr.version   = EIBI_VERSION;
+  hdr.recSize   = sizeof(EibiRecord);
+  hdr.count     = count;
+  hdr.nameCount = names.count;
+  hdr.namesSize = names.size;
+  hdr.flags     = EIBI_SORTED;
+
+  bool ok;
+
+  if(eibiPart)
   {
-    file.close();
-    return(NULL);
+    // Must fit into the partition
+    size_t size = eibiDataSize(&hdr);
+    size = (size + eibiPart->erase_size - 1) / eibiPart->erase_size * eibiPart->erase_size;
+
+    // Unmap and erase old schedule
+    eibiDrop();
+    ok = size <= eibiPart->size && esp_partition_erase_range(eibiPart, 0, size) == ESP_OK;
+
+    // Header goes in last, so that partial data is never valid
+    outPos = sizeof(hdr);
+  }
+  else
+  {
+    outFile = LittleFS.open(path, "wb");
+    outPos = 0;
+    ok = outFile && outWrite(&hdr, sizeof(hdr));
   }
 
-  StationSchedule *result = NULL;
-  int now = hour * 60 + minute;
+  // Copy records
+  uint8_t buf[512];
+  recs.seek(0, fs::SeekSet);
+  for(size_t n ; ok && (n = recs.read(buf, sizeof(buf))) > 0 ; )
+    ok = outWrite(buf, n);
+
+  // Align and append frequency directory and name table
+  ok = ok && (!padSize || outWrite(padding, padSize));
+  ok = ok && outWrite(buckets, sizeof(buckets));
+  ok = ok && outWrite(names.offsets, names.count * sizeof(uint32_t));
+  ok = ok && outWrite(words, hdr.wordCount * sizeof(uint32_t));
+  ok = ok && outWrite(names.text, names.size);
+  free(words);
+
+  if(eibiPart)
+    ok = ok && esp_partition_write(eibiPart, 0, &hdr, sizeof(hdr)) == ESP_OK;
+  else if(outFile)
+    outFile.close();
+
+  return(ok);
+}
+
+//
+// Receive a compiled schedule image over a serial stream, checking
+// its CRC32 before making it current. The sender sends the header,
+// waits for "[EIBI] Continue", and only then sends the rest, so that
+// nothing arrives while the partition is being erased.
+//
+#define EIBI_RECEIVE_TIMEOUT 3000
+#define EIBI_DRAIN_TIMEOUT   500
+
+static bool eibiReceiveStart(const EibiHeader *hdr, size_t size)
+{
+  if(hdr->magic!=EIBI_MAGIC || hdr->version!=EIBI_VERSION || eibiDataSize(hdr)!=size)
+    return(false);
 
-  if(same && entryIsNow(&e0, now))
+  if(eibiPart)
   {
-    entry = e0;
-    result = &entry;
-    file.close();
-    return(result);
+    // Unmap and erase old schedule, header goes in last
+    size_t erase = (size + eibiPart->erase_size - 1) / eibiPart->erase_size * eibiPart->erase_size;
+    if(erase > eibiPart->size) return(false);
+
+    eibiDrop();
+    outPos = sizeof(EibiHeader);
+    return(esp_partition_erase_range(eibiPart, 0, erase)==ESP_OK);
   }
 
-  while(file.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry))
+  outFile = LittleFS.open(TEMP_PATH, "wb");
+  outPos = 0;
+  return(outFile && outWrite(hdr, sizeof(EibiHeader)));
+}
+
+//
+// Check the data written to the partition against the header CRC,
+// before the header makes it valid
+//
+static bool eibiReceiveVerify(const EibiHeader *hdr, size_t size)
+{
+  uint8_t buf[512];
+  uint32_t crc = 0;
+
+  for(size_t pos = sizeof(EibiHeader), n ; pos < size ; pos += n)
   {
-    if(entry.freq != e0.freq)
-      break;
-    else if(entryIsNow(&entry, now))
-    {
-      *offset = file.position() - sizeof(entry);
-      result = &entry;
-      break;
-    }
+    n = min(sizeof(buf), size - pos);
+    if(esp_partition_read(eibiPart, pos, buf, n)!=ESP_OK) return(false);
+    crc = esp_rom_crc32_le(crc, buf, n);
   }
 
-  file.close();
-  return(result);
+  return(crc==hdr->crc);
 }
 
-const StationSchedule *eibiLookup(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset)
+bool eibiReceiveSchedule(Stream &in, size_t size, uint32_t crc)
 {
-  // Will return this static entry
-  static StationSchedule entry;
+  static const char *eibiMessage = "Receiving EiBi Schedule";
+  EibiHeader hdr;
+  uint8_t buf[512];
+  size_t got = 0;
+  uint32_t sum = 0;
+  uint32_t lastTime = millis();
 
-  // Open file with EIBI data
-  fs::File file = LittleFS.open(EIBI_PATH, "rb");
-  if(!file) return(NULL);
+  // Not while the network task is downloading a schedule
+  if(eibiLoading) return(false);
+
+  drawScreen(eibiMessage, "Receiving...");
 
-  // Set up binary search
-  ssize_t total = file.size() / sizeof(entry);
-  ssize_t left  = 0;
-  ssize_t right = total;
-  ssize_t match = -1;
-  ssize_t mid;
+  // Must at least have a header
+  bool ok = size >= sizeof(hdr);
 
-  // Search for the frequency
-  while(left <= right)
+  // Receive data, starting with the header
+  while(ok && got<size && millis() - lastTime < EIBI_RECEIVE_TIMEOUT)
   {
-    // Go to the middle entry
-    mid = (left + right) / 2;
+    uint8_t *dst = got<sizeof(hdr)? (uint8_t *)&hdr + got : buf;
+    size_t n = got<sizeof(hdr)? sizeof(hdr) - got : min(sizeof(buf), size - got);
 
-    // Save current offset, correcting for file size
-    if(offset) *offset = (mid<0? 0 : mid>=total? total-1 : mid) * sizeof(entry);
+    n = min(n, (size_t)in.available());
+    if(!n) { delay(1); continue; }
 
-    // Go to the middle entry
-    if(!file.seek(mid * sizeof(entry), fs::SeekSet))
-    {
-      file.close();
-      return(NULL);
-    }
+    n = in.readBytes((char *)dst, n);
+    sum = esp_rom_crc32_le(sum, dst, n);
+    got += n;
 
-    // Read middle entry
-    if(file.read((uint8_t*)&entry, sizeof(entry)) != sizeof(entry))
-    {
-      file.close();
-      return(NULL);
-    }
+    // Once we have the header, check it before touching storage
+    if(dst==buf) ok = outWrite(buf, n);
+    else if(got==sizeof(hdr) && (ok = eibiReceiveStart(&hdr, size))) in.println("[EIBI] Continue");
 
-    // Compare frequency
-    if(entry.freq < freq)
-      left = mid + 1;
-    else if(entry.freq > freq)
-      right = mid - 1;
-    else
-    {
-      match = mid;
-      right = mid - 1;
-    }
+    // Erasing and writing flash must not count against the timeout
+    lastTime = millis();
   }
 
-  // Drop out if not found
-  if(match < 0)
-  {
-    file.close();
-    return(NULL);
-  }
+  // Must have received complete and correct data
+  ok = ok && got==size && sum==crc;
 
-  // If found entry is not the same as the last read entry...
-  if(match != mid)
+  // The old schedule is already erased from the partition, only make
+  // the new one valid once it reads back correctly
+  if(eibiPart)
+    ok = ok && eibiReceiveVerify(&hdr, size) && esp_partition_write(eibiPart, 0, &hdr, sizeof(hdr))==ESP_OK;
+  else if(outFile)
   {
-    // Read the right entry
-    if(file.seek(match * sizeof(entry), fs::SeekSet))
-      if(file.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry))
-        mid = match;
-
-    // Drop out if failed to read
-    if(match != mid)
+    outFile.close();
+    if(ok)
     {
-      file.close();
-      return(NULL);
+      LittleFS.remove(EIBI_PATH);
+      LittleFS.rename(TEMP_PATH, EIBI_PATH);
     }
+    else
+      LittleFS.remove(TEMP_PATH);
   }
 
-  // This is our current time in minutes
-  int now = hour * 60 + minute;
-
-  // Keep reading entries from file
-  do
+  // Consume the rest of a failed upload, until the sender goes quiet,
+  // so that it does not end up parsed as commands
+  for(lastTime = millis() ; got<size && millis() - lastTime < EIBI_DRAIN_TIMEOUT ; )
   {
-    // Report offset within the file
-    if(offset) *offset = file.position() - sizeof(entry);
+    size_t n = min(min(sizeof(buf), size - got), (size_t)in.available());
+    if(!n) { delay(1); continue; }
+
+    got += in.readBytes((char *)buf, n);
+    lastTime = millis();
+  }
 
-    // Match frequency
-    if(entry.freq != freq) break;
+  // Load new schedule into memory
+  ok = ok && eibiReload();
 
-    // Match time
-    if(entryIsNow(&entry, now))
-    {
-      file.close();
-      return(&entry);
-    }
+  // Cache validators do not apply to the uploaded schedule
+  if(ok && prefs.begin("eibi", false, STORAGE_PARTITION))
+  {
+    prefs.remove("etag");
+    prefs.remove("modified");
+    prefs.end();
   }
-  while(file.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry));
 
-  // Not found
-  file.close();
-  return(NULL);
+  if(ok) identifyFrequency(currentFrequency + currentBFO / 1000);
+  drawScreen(eibiMessage, ok? "DONE!" : "Failed receiving schedule!");
+  return(ok);
 }
 
-char replace_accented_char(char c)
+//
+// Gzip decoder state, used when the server compresses the schedule
+//
+#define GZIP_INPUT_SIZE 4096
+
+struct GzipState
 {
-  switch((unsigned char)c)
+  tinfl_decompressor inflator;
+  uint8_t dict[TINFL_LZ_DICT_SIZE]; // Sliding window of output data
+  uint8_t in[GZIP_INPUT_SIZE];      // Compressed input data
+  size_t  inPos, inLen;             // Unused input in in[]
+  size_t  dictPos;                  // Next output position in dict[]
+  bool    header;                   // TRUE once gzip header skipped
+  bool    done;                     // TRUE at the end of compressed data
+};
+
+static GzipState *gzip = NULL;
+
+//
+// Get gzip header size, 0 if incomplete, -1 if invalid
+//
+static int gzipHeaderSize(const uint8_t *p, size_t len)
+{
+  if(len < 10) return(0);
+  if(p[0]!=0x1F || p[1]!=0x8B || p[2]!=8) return(-1);
+
+  uint8_t flags = p[3];
+  size_t j = 10;
+
+  // Skip extra field
+  if(flags & 0x04)
   {
-    // Lowercase vowels with accents
-    case 0xE1: case 0xE0: case 0xE2: case 0xE3: case 0xE4: return 'a'; // á, à, â, ã, ä
-    case 0xE9: case 0xE8: case 0xEA: case 0xEB: return 'e';             // é, è, ê, ë
-    case 0xED: case 0xEC: case 0xEE: case 0xEF: return 'i';            // í, ì, î, ï
-    case 0xF3: case 0xF2: case 0xF4: case 0xF5: case 0xF6: return 'o';  // ó, ò, ô, õ, ö
-    case 0xFA: case 0xF9: case 0xFB: case 0xFC: return 'u';             // ú, ù, û, ü
-    // Uppercase vowels with accents
-    case 0xC1: case 0xC0: case 0xC2: case 0xC3: case 0xC4: return 'A';  // Á, À, Â, Ã, Ä
-    case 0xC9: case 0xC8: case 0xCA: case 0xCB: return 'E';             // É, È, Ê, Ë
-    case 0xCD: case 0xCC: case 0xCE: case 0xCF: return 'I';             // Í, Ì, Î, Ï
-    case 0xD3: case 0xD2: case 0xD4: case 0xD5: case 0xD6: return 'O';  // Ó, Ò, Ô, Õ, Ö
-    case 0xDA: case 0xD9: case 0xDB: case 0xDC: return 'U';             // Ú, Ù, Û, Ü
-    // Other special chars
-    case 0xF1: return 'n';  // ñ
-    case 0xD1: return 'N';  // Ñ
-    case 0xE7: return 'c';  // ç
-    case 0xC7: return 'C';  // Ç
-    default: return c;      // No change
+    if(len < j + 2) return(0);
+    j += 2 + (p[j] | (p[j + 1] << 8));
   }
+
+  // Skip file name and comment
+  for(uint8_t f = 0x08 ; f <= 0x10 ; f <<= 1)
+    if(flags & f)
+    {
+      for( ; j<len && p[j] ; ++j);
+      if(j++ >= len) return(0);
+    }
+
+  // Skip header CRC
+  if(flags & 0x02) j += 2;
+
+  return(j<=len? j : 0);
 }
 
-static bool eibiParseLine(const char *line, StationSchedule &entry)
+//
+// Read the next piece of schedule data, inflating it if the server
+// sent it compressed. Returns number of bytes, 0 if there is no data
+// yet, EIBI_READ_END at the end of data, or EIBI_READ_ERROR.
+//
+#define EIBI_READ_END   (-1)
+#define EIBI_READ_ERROR (-2)
+
+static int eibiReadData(HTTPClient &http, uint8_t *buf, size_t size, int &byteCnt)
 {
-  char nameStr[sizeof(entry.name) + 1];
-  char freqStr[15] = {0};
-  char timeStr[10] = {0};
-  char tmpCol[12]  = {0};
-  char *p, *t;
+  WiFiClient *stream = http.getStreamPtr();
+  int totalLen = http.getSize();
+  bool netEnd = !http.connected() || (totalLen>=0 && byteCnt>=totalLen);
+  int n;
 
-  // Scan line for data
-  if(sscanf(line, "%14c%9c%11c%24c", freqStr, timeStr, tmpCol, nameStr)<3)
-    return(false);
+  // Uncompressed data goes straight into the buffer
+  if(!gzip)
+  {
+    if(netEnd) return(EIBI_READ_END);
+    if(!(n = stream->available())) return(0);
+    n = stream->read(buf, min((size_t)n, size));
+    if(n > 0) byteCnt += n;
+    return(n>0? n : 0);
+  }
 
-  // Terminate found data
-  freqStr[14] = '\0';
-  timeStr[9] = '\0';
-  nameStr[24] = '\0';
+  if(gzip->done) return(EIBI_READ_END);
 
-  // Parse frequency
-  entry.freq = (uint16_t)atof(freqStr);
-  if(!entry.freq) return(false);
+  // Keep unused input at the start of the input buffer
+  if(gzip->inPos)
+  {
+    memmove(gzip->in, gzip->in + gzip->inPos, gzip->inLen - gzip->inPos);
+    gzip->inLen -= gzip->inPos;
+    gzip->inPos  = 0;
+  }
 
-  // Parse time
-  int sh, sm, eh, em;
-  if(sscanf(timeStr, "%2d%2d-%2d%2d", &sh, &sm, &eh, &em) != 4) return(false);
-  entry.start_h = sh;
-  entry.start_m = sm;
-  entry.end_h   = eh;
-  entry.end_m   = em;
+  // Read more compressed input
+  if(!netEnd && gzip->inLen<GZIP_INPUT_SIZE && (n = stream->available()))
+  {
+    n = stream->read(gzip->in + gzip->inLen, min((size_t)n, GZIP_INPUT_SIZE - gzip->inLen));
+    if(n > 0)
+    {
+      gzip->inLen += n;
+      byteCnt += n;
+    }
+  }
 
-  // Remove jammers
-  if(strstr(nameStr, "Jammer")) return(false);
+  // Skip gzip header first
+  if(!gzip->header)
+  {
+    n = gzipHeaderSize(gzip->in, gzip->inLen);
+    if(n < 0 || (!n && (netEnd || gzip->inLen>=GZIP_INPUT_SIZE))) return(EIBI_READ_ERROR);
+    if(!n) return(0);
+    gzip->inPos  = n;
+    gzip->header = true;
+  }
 
-  // Remove leading and trailing white space from name
-  for(p = nameStr ; *p==' ' || *p=='\t' ; ++p);
-  for(t = p + strlen(p) - 1 ; t>=p && (*t==' ' || *t=='\t') ; *t--='\0');
+  // Inflate as much as fits into the buffer and the window
+  size_t inBytes  = gzip->inLen - gzip->inPos;
+  size_t outBytes = min(size, TINFL_LZ_DICT_SIZE - gzip->dictPos);
+  tinfl_status status = tinfl_decompress(&gzip->inflator,
+    gzip->in + gzip->inPos, &inBytes,
+    gzip->dict, gzip->dict + gzip->dictPos, &outBytes,
+    netEnd? 0 : TINFL_FLAG_HAS_MORE_INPUT);
 
-  // Replace accented characters
-  for (t = p; *t != '\0'; t++) {
-    *t = replace_accented_char(*t);
-  }
+  gzip->inPos += inBytes;
+  memcpy(buf, gzip->dict + gzip->dictPos, outBytes);
+  gzip->dictPos = (gzip->dictPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
 
-  // Copy name
-  strncpy(entry.name, p, sizeof(entry.name) - 1);
-  entry.name[sizeof(entry.name)-1] = '\0';
+  // Check for errors and end of data
+  if(status < TINFL_STATUS_DONE) return(EIBI_READ_ERROR);
+  if(status == TINFL_STATUS_DONE) gzip->done = true;
+  else if(!outBytes && netEnd) return(EIBI_READ_ERROR);
 
-  // Done
-  return(true);
+  return(outBytes? outBytes : gzip->done? EIBI_READ_END : 0);
 }
 
-bool eibiLoadSchedule()
+//
+// Loader buffers: network data is read in EIBI_CHUNK_SIZE chunks
+// and records are written out in flash page sized batches
+//
+#define EIBI_CHUNK_SIZE   4096
+#define EIBI_LINE_MAX     256
+#define EIBI_BATCH_SIZE   (4096 / sizeof(EibiRecord))
+#define EIBI_PROGRESS_MS  250
+#define EIBI_STATUS_MS    3000
+
+//
+// Publish loader status for loop(), see eibiLoadStatus()
+//
+static void eibiSetStatus(const char *status, int byteCnt = 0, int lineCnt = 0)
+{
+  loadBytes  = byteCnt;
+  loadLines  = lineCnt;
+  loadStatus = status;
+  __sync_synchronize();
+  loadSeq = loadSeq + 1;
+}
+
+static bool eibiDownload()
 {
-  static const char *eibiMessage = "Loading EiBi Schedule";
+  static const char *headerKeys[] = { "ETag", "Last-Modified", "Content-Encoding" };
+  Preferences eibiPrefs;
   HTTPClient http;
 
   // Need to be connected to the network
-  if(getWiFiStatus() < 2) return(false);
+  if(getWiFiStatus() < 2)
+  {
+    eibiSetStatus("No network connection!");
+    return(false);
+  }
 
-  drawScreen(eibiMessage, "Connecting...");
+  eibiSetStatus("Connecting...");
 
-  // Open HTTP connection to EiBi site
+  // Open HTTP connection to EiBi site, using HTTP/1.0 to get
+  // plain (not chunked) data and to be able to ask for gzip
   http.begin(EIBI_URL);
-  if(http.GET() != HTTP_CODE_OK)
+  http.useHTTP10(true);
+  http.collectHeaders(headerKeys, ITEM_COUNT(headerKeys));
+  http.addHeader("Accept-Encoding", "gzip");
+
+  // Only ask for the schedule if it changed since the last download.
+  // The global prefs belong to loop(), use own instance.
+  if(eibiCount && eibiPrefs.begin("eibi", true, STORAGE_PARTITION))
+  {
+    String etag = eibiPrefs.getString("etag", "");
+    String modified = eibiPrefs.getString("modified", "");
+    eibiPrefs.end();
+
+    if(etag.length()) http.addHeader("If-None-Match", etag);
+    if(modified.length()) http.addHeader("If-Modified-Since", modified);
+  }
+
+  int code = http.GET();
+  if(code == HTTP_CODE_NOT_MODIFIED)
+  {
+    eibiSetStatus("Up to date!");
+    http.end();
+    return(true);
+  }
+  else if(code != HTTP_CODE_OK)
   {
-    drawScreen(eibiMessage, "Failed connecting to EiBi!");
+    eibiSetStatus("Failed connecting to EiBi!");
     http.end();
     return(false);
   }
 
+  // Remember cache validators for the next download
+  String etag = http.header("ETag");
+  String modified = http.header("Last-Modified");
+
+  // Allocate buffers, with room for a partial line before each chunk
+  char *chunk = (char *)malloc(EIBI_LINE_MAX + EIBI_CHUNK_SIZE + 1);
+  EibiRecord *batch = (EibiRecord *)malloc(EIBI_BATCH_SIZE * sizeof(EibiRecord));
+
+  // Allocate decoder, if data is compressed
+  bool compressed = http.header("Content-Encoding") == "gzip";
+  gzip = compressed? (GzipState *)ps_malloc(sizeof(GzipState)) : NULL;
+  if(gzip)
+  {
+    tinfl_init(&gzip->inflator);
+    gzip->inPos = gzip->inLen = gzip->dictPos = 0;
+    gzip->header = gzip->done = false;
+  }
+
   // Open file in the local flash file system
-  fs::File file = LittleFS.open(TEMP_PATH, "wb");
-  if(!file)
+  fs::File file = LittleFS.open(RECS_PATH, "w+");
+  if(!file || !chunk || !batch || (compressed && !gzip) || !namesInit())
   {
-    drawScreen(eibiMessage, "Failed opening local storage!");
+    if(file) file.close();
+    free(chunk);
+    free(batch);
+    free(gzip);
+    gzip = NULL;
+    eibiSetStatus("Failed opening local storage!");
     http.end();
     return(false);
   }
 
   // Start loading data
-  WiFiClient *stream = http.getStreamPtr();
-  int totalLen = http.getSize();
-  int byteCnt, lineCnt, charCnt;
-  char charBuf[200];
+  int byteCnt = 0, lineCnt = 0;
+  size_t batchCnt = 0, lineLen = 0;
+  uint32_t progressTime = millis();
+  const char *error = "Failed writing local storage!";
+  bool ok = true, done = false;
 
-  for(byteCnt = charCnt = lineCnt = 0 ; http.connected() && (totalLen<0 || byteCnt<totalLen) ; )
+  while(ok && !done)
   {
-    if(!stream->available()) delay(1);
-    else
-    {
-      char c = stream->read();
-      byteCnt++;
+    char *buf = chunk + EIBI_LINE_MAX;
+
+    // Read the next chunk of data, or finish if there is no more
+    int n = eibiReadData(http, (uint8_t *)buf, EIBI_CHUNK_SIZE, byteCnt);
+    if(!n) { delay(1); continue; }
+    if(n == EIBI_READ_ERROR) { error = "Failed reading EiBi data!"; ok = false; break; }
+    if(n == EIBI_READ_END) { done = true; n = 0; }
+
+    // Terminate the last line, if it has no line feed
+    if(done) buf[n++] = '\n';
 
-      if(c!='\n' && charCnt<sizeof(charBuf)-1) charBuf[charCnt++] = c;
-      else
+    // The partial line from the previous chunk sits right before buf
+    char *line = buf - lineLen;
+    char *end  = buf + n;
+
+    for(char *eol ; (eol = (char *)memchr(buf, '\n', end - buf)) ; buf = line = eol + 1)
+    {
+      char *p, *t;
+
+      // Remove whitespace, including CRs. Compare unsigned, so that
+      // UTF-8 bytes are kept whether char is signed or not.
+      for(p = line ; p<eol && (uint8_t)*p<=' ' ; ++p);
+      for(t = eol ; t>p && (uint8_t)t[-1]<=' ' ; --t);
+
+      // If valid non-empty schedule line...
+      EibiRecord &entry = batch[batchCnt];
+      char name[LEN_NAME + 1], lang[LEN_LANG + 1], target[LEN_TARGET + 1];
+      int id;
+      if(t>p && isdigit(*p) && eibiParseLine(p, t - p, entry, name, sizeof(name), lang, target) && (id = namesIntern(name))>=0)
       {
-        char *p, *t;
+        // Language and target codes share the name table
+        int langId   = *lang? namesIntern(lang) : -1;
+        int targetId = *target? namesIntern(target) : -1;
 
-        // Remove whitespace
-        charBuf[charCnt] = '\0';
-        for(p = charBuf ; *p && *p<=' ' ; ++p);
-        for(t = charBuf + charCnt - 1 ; t>=p && *t<=' ' ; *t--='\0');
+        // Only station names go into the word index
+        names.stations[id / 32] |= 1UL << (id % 32);
 
-        // If valid non-empty schedule line...
-        if(t-p+1>0 && isdigit(*p))
+        entry.name   = id;
+        entry.lang   = langId>=0? langId : EIBI_NO_CODE;
+        entry.target = targetId>=0? targetId : EIBI_NO_CODE;
+        lineCnt++;
+
+        // Write out a full batch of entries
+        if(++batchCnt >= EIBI_BATCH_SIZE)
         {
-          // Remove LFs
-          for(t = p ; *t ; ++t)
-            if(*t=='\r') *t = ' ';
-
-          // If parsed a new entry...
-          StationSchedule entry;
-          if(eibiParseLine(p, entry))
-          {
-            // Write it to the output file
-            file.write((uint8_t*)&entry, sizeof(entry));
-            lineCnt++;
-
-            if(!(lineCnt & 31))
-            {
-              char statusMessage[64];
-              sprintf(statusMessage, "... %d bytes, %d entries ...", byteCnt, lineCnt);
-              drawScreen(eibiMessage, statusMessage);
-            }
-          }
+          ok = file.write((uint8_t *)batch, batchCnt * sizeof(EibiRecord)) == batchCnt * sizeof(EibiRecord);
+          batchCnt = 0;
         }
-
-        // Done with the current buffer, start a new one
-        charCnt = 0;
-        if(c!='\n') charBuf[charCnt++] = c;
       }
     }
+
+    // Keep partial line for the next chunk, truncating overly long lines
+    lineLen = end - line < EIBI_LINE_MAX? end - line : EIBI_LINE_MAX;
+    memmove(chunk + EIBI_LINE_MAX - lineLen, line, lineLen);
+
+    // Report progress periodically
+    if(millis() - progressTime >= EIBI_PROGRESS_MS)
+    {
+      eibiSetStatus(loadProgress, byteCnt, lineCnt);
+      progressTime = millis();
+    }
   }
 
-  // Done with file and HTTP connection
-  file.close();
+  // Write out remaining entries
+  ok = ok && file.write((uint8_t *)batch, batchCnt * sizeof(EibiRecord)) == batchCnt * sizeof(EibiRecord);
+  free(chunk);
+  free(batch);
+  free(gzip);
+  gzip = NULL;
+
+  // Done with HTTP connection
   http.end();
 
-  // Move new schedule to its permanent place
-  LittleFS.remove(EIBI_PATH);
-  LittleFS.rename(TEMP_PATH, EIBI_PATH);
+  // Sort records by frequency and time
+  eibiSetStatus("Sorting...");
+  ok = ok && eibiSortRecords(file, lineCnt);
+
+  // Compile records and names into the final schedule
+  ok = ok && eibiWriteSchedule(TEMP_PATH, file, lineCnt);
+  if(file) file.close();
+  namesFree();
+  LittleFS.remove(RECS_PATH);
+  LittleFS.remove(SORT_PATH);
+
+  if(!ok)
+  {
+    LittleFS.remove(TEMP_PATH);
+    eibiSetStatus(error);
+    return(false);
+  }
+
+  // Move new schedule file to its permanent place
+  if(!eibiPart)
+  {
+    LittleFS.remove(EIBI_PATH);
+    LittleFS.rename(TEMP_PATH, EIBI_PATH);
+  }
+
+  // Load new schedule into memory
+  eibiReload();
+
+  // Save cache validators for the new schedule
+  if(eibiPrefs.begin("eibi", false, STORAGE_PARTITION))
+  {
+    eibiPrefs.putString("etag", etag);
+    eibiPrefs.putString("modified", modified);
+    eibiPrefs.end();
+  }
 
   // Success
-  identifyFrequency(currentFrequency + currentBFO / 1000);
-  drawScreen(eibiMessage, "DONE!");
+  eibiSetStatus("DONE!");
+  return(true);
+}
+
+//
+// Download, compile, and load EiBi schedule. Runs in the network task
+// (see eibiRequestLoad()), taking minutes, while loop() keeps going.
+//
+bool eibiLoadSchedule()
+{
+  eibiLoading = true;
+  bool ok = eibiDownload();
+
+  // Hand the schedule back to loop(), after all writes to it
+  __sync_synchronize();
+  eibiLoading = false;
+  return(ok);
+}
+
+//
+// Start downloading EiBi schedule in the network task. Called from
+// loop(), returns FALSE if the download could not be started.
+//
+bool eibiRequestLoad()
+{
+  // Need to be connected to the network, one download at a time
+  if(eibiLoading || getWiFiStatus() < 2) return(false);
+
+  // Callers drop entries they hold from the current schedule
+  eibiLoading = true;
+  eibiGen++;
+  eibiSetStatus("Connecting...");
+
+  if(!netRequest(NET_CMD_EIBI))
+  {
+    eibiLoading = false;
+    eibiSetStatus("Network busy!");
+    loadDoneTime = millis();
+    return(false);
+  }
+
+  loadPending = true;
   return(true);
 }
+
+//
+// Get status line of the running or just finished download, or NULL
+//
+const char *eibiLoadStatus()
+{
+  static char progress[64];
+  const char *status = loadStatus;
+
+  if(status != loadProgress) return(status);
+
+  sprintf(progress, "... %d bytes, %d entries ...", loadBytes, loadLines);
+  return(progress);
+}
+
+//
+// Track schedule download, called from loop(). Returns TRUE when the
+// screen needs to be redrawn.
+//
+bool eibiTickTime()
+{
+  static uint32_t seqSeen = 0;
+  bool result = false;
+
+  // Status changed
+  if(seqSeen != loadSeq)
+  {
+    seqSeen = loadSeq;
+    result = true;
+  }
+
+  // Network task is done, look up current station in the new schedule
+  if(loadPending && !eibiLoading)
+  {
+    __sync_synchronize();
+    loadPending = false;
+    loadDoneTime = millis();
+    identifyFrequency(currentFrequency + currentBFO / 1000);
+    result = true;
+  }
+
+  // Remove the final status after a while
+  if(!eibiLoading && loadStatus && millis() - loadDoneTime >= EIBI_STATUS_MS)
+  {
+    loadStatus = NULL;
+    result = true;
+  }
+
+  return(result);
+}
@@ -15,14 +15,89 @@ struct StationSchedule
   int8_t   start_m;     // Starting minute
   int8_t   end_h;       // Ending hour
   int8_t   end_m;       // Ending minute
-  char     name[32];    // Station name (UTF-8)
+  uint8_t  days;        // Weekdays on air (EIBI_DAY_MON << n)
+  uint8_t  source;      // Source schedule
+  const char *name;     // Station name (UTF-8)
+  const char *lang;     // Language code(s), e.g. "E" or "-CW"
+  const char *target;   // Target area code, e.g. "Eu" or "NAm"
 };
 
+//
+// Compiled schedule layout (version 7), stored in the raw "eibi" flash
+// partition when there is one, or in /schedules.bin on LittleFS:
+//   EibiHeader
+//   EibiRecord[count]      (sorted by frequency, then start time)
+//   uint8_t[0 or 2]        (zero padding to a multiple of 4 bytes)
+//   uint32_t[EIBI_BUCKETS+1] (first record in each frequency bucket)
+//   uint32_t[nameCount]    (name offsets into the string table)
+//   uint32_t[wordCount]    (name word offsets, sorted by the text that follows)
+//   char[namesSize]        (zero-terminated unique names and codes)
+//
+#define EIBI_MAGIC    0x49424945 // "EIBI"
+#define EIBI_VERSION  7
+#define EIBI_SORTED   0x0001     // Records verified to be in order
+#define EIBI_ANYTIME  0xFFFF     // Start/end time for all-day entries
+#define EIBI_MAX_NAMES 0xFFFF    // Name IDs are 16bit
+#define EIBI_NO_CODE  0xFFFF     // Language or target not given
+
+// Weekdays, as found in EibiRecord.days
+#define EIBI_DAY_MON  0x01
+#define EIBI_DAY_SUN  0x40
+#define EIBI_DAILY    0x7F
+
+// Frequency directory buckets, covering EIBI_BUCKET_MIN..EIBI_BUCKET_MAX kHz
+#define EIBI_BUCKETS    256
+#define EIBI_BUCKET_MIN 150
+#define EIBI_BUCKET_MAX 30000
+#define EIBI_BUCKET_KHZ ((EIBI_BUCKET_MAX - EIBI_BUCKET_MIN + EIBI_BUCKETS - 1) / EIBI_BUCKETS)
+
+struct EibiHeader
+{
+  uint32_t magic;       // EIBI_MAGIC
+  uint16_t version;     // EIBI_VERSION
+  uint16_t recSize;     // sizeof(EibiRecord)
+  uint32_t count;       // Number of records
+  uint32_t nameCount;   // Number of unique names
+  uint32_t namesSize;   // String table size in bytes
+  uint32_t wordCount;   // Number of name word offsets
+  uint32_t flags;       // EIBI_SORTED, etc.
+  uint32_t crc;         // CRC32 of everything following the header
+};
+
+// Records take 14 bytes, padded so that the uint32_t tables following
+// them stay aligned (Xtensa faults on misaligned 32bit loads)
+#define EIBI_RECORDS_SIZE(count) (((count) * sizeof(EibiRecord) + 3) & ~(size_t)3)
+
+struct EibiRecord
+{
+  uint16_t freq;        // Frequency in kHz
+  uint16_t start;       // Starting time in minutes (or EIBI_ANYTIME)
+  uint16_t end;         // Ending time in minutes (or EIBI_ANYTIME)
+  uint16_t name;        // Index into the name table
+  uint16_t lang;        // Language code, index into the name table
+  uint16_t target;      // Target area code, index into the name table
+  uint8_t  days;        // Weekdays on air (EIBI_DAY_MON << n)
+  uint8_t  source;      // Source schedule (0 = EiBi, see tools/eibi.py merge)
+};
+
+const BandLabel *getBandLabel(int idx);
+uint64_t bandLabelsAt(uint16_t freq, uint16_t *next = NULL);
+
+void eibiInit();
 bool eibiAvailable();
+uint32_t eibiGeneration();
 bool eibiLoadSchedule();
+bool eibiRequestLoad();
+const char *eibiLoadStatus();
+bool eibiTickTime();
+bool eibiReceiveSchedule(Stream &in, size_t size, uint32_t crc);
 const StationSchedule *eibiLookup(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset=NULL);
 const StationSchedule *eibiPrev(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset);
 const StationSchedule *eibiNext(uint16_t freq, uint8_t hour, uint8_t minute, size_t *offset);
 const StationSchedule *eibiAtSameFreq(uint8_t hour, uint8_t minute, size_t *offset, bool same);
+int eibiValidFor(uint16_t freq, uint8_t hour, uint8_t minute);
+size_t eibiFind(const char *query, uint8_t hour, uint8_t minute, StationSchedule *results, size_t maxResults);
+void eibiSetFilter(const char *langs, const char *targets);
+const char *eibiGetFilter(bool target);
 
 #endif // EIBI_H
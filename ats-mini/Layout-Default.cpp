@@ -61,7 +61,11 @@ void drawLayoutDefault(const char *statusLine1, const char *statusLine2)
 
   if(currentCmd == CMD_SCAN)
   {
-    drawScanGraphs(isSSB()? (currentFrequency + currentBFO/1000) : currentFrequency);
+    uint32_t freq = isSSB()? (currentFrequency + currentBFO/1000) : currentFrequency;
+    if(uiLayoutIdx == UI_WATERFALL)
+      drawScanWaterfall(freq);
+    else
+      drawScanGraphs(freq);
   }
   else if(!drawWiFiStatus(statusLine1, statusLine2, STATUS_OFFSET_X, STATUS_OFFSET_Y))
   {
@@ -80,13 +80,14 @@ Band *getCurrentBand() { return(&bands[bandIdx]); }
 #define MENU_SEEK         4
 #define MENU_SCAN         5
 #define MENU_MEMORY       6
-#define MENU_SQUELCH      7
-#define MENU_BW           8
-#define MENU_AGC_ATT      9
-#define MENU_AVC         10
-#define MENU_SOFTMUTE    11
-#define MENU_SETTINGS    12
-#define MENU_GALGAME     13
+#define MENU_STATIONS     7
+#define MENU_SQUELCH      8
+#define MENU_BW           9
+#define MENU_AGC_ATT     10
+#define MENU_AVC         11
+#define MENU_SOFTMUTE    12
+#define MENU_SETTINGS    13
+#define MENU_GALGAME     14
 
 int8_t menuIdx = MENU_VOLUME;
 
@@ -99,6 +100,7 @@ static const char *menu[] =
   "Seek",
   "Scan",
   "Memory",
+  "Stations",
   "Squelch",
   "Bandwidth",
   "AGC/ATTN",
@@ -124,9 +126,10 @@ static const char *menu[] =
 #define MENU_SLEEP        9
 #define MENU_SLEEPMODE    10
 #define MENU_LOADEIBI     11
-#define MENU_BLEMODE      14
-#define MENU_WIFIMODE     12
-#define MENU_ABOUT        13
+#define MENU_BLEMODE      15
+#define MENU_WIFIMODE     13
+#define MENU_ABOUT        14
+#define MENU_SCANMODE     12
 
 
 int8_t settingsIdx = MENU_BRIGHTNESS;
@@ -145,6 +148,7 @@ static const char *settings[] =
   "Sleep",
   "Sleep Mode",
   "Load EiBi",
+  "Scan Mode",
 //  "Bluetooth",
   "Wi-Fi",
   "About",
@@ -180,6 +184,17 @@ Memory newMemory;
 
 int getTotalMemories() { return(ITEM_COUNT(memories)); }
 
+//
+// Stations Menu (other frequencies of the current EiBi station)
+//
+
+#define STATION_COUNT 16
+
+static StationSchedule stations[STATION_COUNT];
+static uint8_t stationCount = 0;
+static uint8_t stationIdx = 0;
+static uint32_t stationGen = 0;
+
 //
 // RDS Menu
 //
@@ -207,6 +222,14 @@ uint8_t sleepModeIdx = SLEEP_LOCKED;
 static const char *sleepModeDesc[] =
 { "Locked", "Unlocked", "CPU Sleep" };
 
+//
+// Scan Mode Menu
+//
+
+uint8_t scanModeIdx = SCAN_FIXED;
+static const char *scanModeDesc[] =
+{ "Fixed", "Adaptive" };
+
 //
 // UTC Offset Menu
 // FIXME: add more offsets https://en.wikipedia.org/wiki/List_of_UTC_offsets
@@ -244,7 +267,7 @@ int getTotalUTCOffsets() { return(ITEM_COUNT(utcOffsets)); }
 //
 uint8_t uiLayoutIdx = 0;
 static const char *uiLayoutDesc[] =
-{ "Default", "S-Meter" };
+{ "Default", "S-Meter", "Waterfall" };
 
 //
 // Bluetooth Mode Menu
@@ -547,11 +570,15 @@ static void clickScan(bool shortPress)
     // Clear stale parameters
     clearStationInfo();
     rssi = snr = 0;
-    drawScreen();
-    drawMessage("Scanning...");
-    scanRun(currentFrequency, 10);
+    // Main loop runs the scan, drawing results as they arrive,
+    // waterfall layout keeps sweeping until stopped
+    scanStart(currentFrequency, 10, scanModeIdx == SCAN_ADAPTIVE, uiLayoutIdx == UI_WATERFALL);
+  }
+  else
+  {
+    scanStop();
+    currentCmd = CMD_NONE;
   }
-  else currentCmd = CMD_NONE;
 }
 
 static void doTheme(int dir)
@@ -616,6 +643,11 @@ static void doSleepMode(int dir)
   sleepModeIdx = wrap_range(sleepModeIdx, dir, 0, LAST_ITEM(sleepModeDesc));
 }
 
+static void doScanMode(int dir)
+{
+  scanModeIdx = wrap_range(scanModeIdx, dir, 0, LAST_ITEM(scanModeDesc));
+}
+
 static void doBleMode(int dir)
 {
   uint8_t newBleModeIdx = wrap_range(bleModeIdx, dir, 0, LAST_ITEM(bleModeDesc));
@@ -722,6 +754,58 @@ static void clickMemory(uint8_t idx, bool shortPress)
   else currentCmd = CMD_NONE;
 }
 
+static void findStations()
+{
+  const char *name = getStationName();
+  uint8_t hour, minute;
+
+  stationCount = stationIdx = 0;
+  stationGen = eibiGeneration();
+
+  // Skip the long (EiBi) name marker
+  if((uint8_t)name[0]==0xFF) name++;
+
+  // Must have station name and valid time
+  if(!*name || !clockGetHM(&hour, &minute)) return;
+
+  stationCount = eibiFind(name, hour, minute, stations, ITEM_COUNT(stations));
+
+  // Start with the current frequency, if found
+  for(int j = 0 ; j < stationCount ; ++j)
+    if(stations[j].freq==currentFrequency + currentBFO / 1000) stationIdx = j;
+}
+
+//
+// Found stations point into the schedule, drop them once it reloads
+//
+static void checkStations()
+{
+  if(stationGen!=eibiGeneration()) stationCount = stationIdx = 0;
+}
+
+static void doStations(int dir)
+{
+  // Must have stations
+  checkStations();
+  if(!stationCount) return;
+
+  stationIdx = wrap_range(stationIdx, dir, 0, stationCount - 1);
+
+  // Find band with the station, preferring the current band
+  Memory memory = {0};
+  memory.freq = freqToHz(stations[stationIdx].freq, AM);
+  memory.mode = AM;
+  memory.band = bandIdx;
+
+  for(int j = 0 ; j < getTotalBands() && !isMemoryInBand(&bands[memory.band], &memory) ; ++j)
+    memory.band = j;
+
+  // Tune using the band's own modulation
+  memory.mode = bands[memory.band].bandMode;
+  memory.freq = freqToHz(stations[stationIdx].freq, memory.mode);
+  tuneToMemory(&memory);
+}
+
 void doStep(int dir)
 {
   uint8_t idx = bands[bandIdx].currentStepIdx;
@@ -867,6 +951,15 @@ static void clickMenu(int cmd, bool shortPress)
       if(currentMode!=FM) currentCmd = CMD_AVC;
       break;
 
+    case MENU_STATIONS:
+      // Need EiBi schedule and valid time, not in FM mode
+      if(currentMode!=FM && eibiAvailable() && clockAvailable())
+      {
+        currentCmd = CMD_STATIONS;
+        findStations();
+      }
+      break;
+
     case MENU_SCAN:
       // Run a band scan around current frequency with the same
       // step as scale resolution (10kHz for AM, 100kHz for FM)
@@ -905,6 +998,7 @@ static void clickSettings(int cmd, bool shortPress)
     case MENU_UTCOFFSET:  currentCmd = CMD_UTCOFFSET; break;
     case MENU_BLEMODE:    currentCmd = CMD_BLEMODE;   break;
     case MENU_WIFIMODE:   currentCmd = CMD_WIFIMODE;  break;
+    case MENU_SCANMODE:   currentCmd = CMD_SCANMODE;  break;
     case MENU_FM_REGION:
       // Only in FM mode
       if(currentMode==FM) currentCmd = CMD_FM_REGION;
@@ -912,7 +1006,7 @@ static void clickSettings(int cmd, bool shortPress)
     case MENU_ABOUT:      currentCmd = CMD_ABOUT;     break;
 
     case MENU_LOADEIBI:
-      eibiLoadSchedule();
+      eibiRequestLoad();
       break;
   }
 }
@@ -942,10 +1036,12 @@ bool doSideBar(uint16_t cmd, int dir)
     case CMD_UI:        doUILayout(scrollDirection * dir);break;
     case CMD_RDS:       doRDSMode(scrollDirection * dir);break;
     case CMD_MEMORY:    doMemory(scrollDirection * dir);break;
+    case CMD_STATIONS:  doStations(scrollDirection * dir);break;
     case CMD_SLEEP:     doSleep(dir);break;
     case CMD_SLEEPMODE: doSleepMode(scrollDirection * dir);break;
     case CMD_BLEMODE:   doBleMode(scrollDirection * dir);break;
     case CMD_WIFIMODE:  doWiFiMode(scrollDirection * dir);break;
+    case CMD_SCANMODE:  doScanMode(scrollDirection * dir);break;
     case CMD_ZOOM:      doZoom(dir);break;
     case CMD_SCROLL:    doScrollDir(dir);break;
     case CMD_UTCOFFSET: doUTCOffset(scrollDirection * dir);break;
@@ -965,6 +1061,7 @@ bool clickHandler(uint16_t cmd, bool shortPress)
     case CMD_MENU:     clickMenu(menuIdx, shortPress);break;
     case CMD_SETTINGS: clickSettings(settingsIdx, shortPress);break;
     case CMD_MEMORY:   clickMemory(memoryIdx, shortPress);break;
+    case CMD_STATIONS: currentCmd = CMD_NONE;break;
     case CMD_WIFIMODE: clickWiFiMode(wifiModeIdx, shortPress);break;
     case CMD_VOLUME:   clickVolume(shortPress);break;
     case CMD_SQUELCH:  clickSquelch(shortPress);break;
@@ -1171,6 +1268,12 @@ static void drawScan(int x, int y, int sx)
   spr.drawLine(40+x+(sx/2)-4, 66+y+5, 40+x+(sx/2), 66+y-16+5, TH.menu_param);
   spr.drawLine(40+x+(sx/2), 66+y-16+5, 40+x+(sx/2)+4, 66+y+5, TH.menu_param);
   spr.drawLine(40+x+(sx/2)+4, 66+y+5, 40+x+(sx/2)+17, 66+y+5, TH.menu_param);
+
+  if(scanModeIdx==SCAN_ADAPTIVE)
+  {
+    spr.setTextColor(TH.menu_param, TH.menu_bg);
+    spr.drawString("A", 40+x+(sx/2), 66+y+16, 1);
+  }
 }
 
 static void drawBand(int x, int y, int sx)
@@ -1232,6 +1335,25 @@ static void drawSleepMode(int x, int y, int sx)
   }
 }
 
+static void drawScanMode(int x, int y, int sx)
+{
+  drawCommon(settings[MENU_SCANMODE], x, y, sx, true);
+
+  int count = ITEM_COUNT(scanModeDesc);
+  for(int i=-2 ; i<3 ; i++)
+  {
+    if(i==0) {
+      drawZoomedMenu(scanModeDesc[abs((scanModeIdx+count+i)%count)]);
+      spr.setTextColor(TH.menu_hl_text, TH.menu_hl_bg);
+    } else {
+      spr.setTextColor(TH.menu_item, TH.menu_bg);
+    }
+
+    spr.setTextDatum(MC_DATUM);
+    spr.drawString(scanModeDesc[abs((scanModeIdx+count+i)%count)], 40+x+(sx/2), 64+y+(i*16), 2);
+  }
+}
+
 static void drawBleMode(int x, int y, int sx)
 {
   drawCommon(settings[MENU_BLEMODE], x, y, sx, true);
@@ -1395,6 +1517,38 @@ static void drawMemory(int x, int y, int sx)
   }
 }
 
+static void drawStations(int x, int y, int sx)
+{
+  drawCommon(menu[MENU_STATIONS], x, y, sx, true);
+
+  checkStations();
+  int count = stationCount;
+  for(int i=-2 ; i<3 ; i++)
+  {
+    char buf[16];
+    const char *text = buf;
+
+    // Prevent repeats for short lists
+    if(count < 5 && ((stationIdx+i) < 0 || (stationIdx+i) >= count))
+    {
+      if(i) continue;
+      text = "- - -";
+    }
+    else
+      sprintf(buf, "%5d kHz", stations[abs((stationIdx+count+i)%count)].freq);
+
+    if(i==0) {
+      drawZoomedMenu(text);
+      spr.setTextColor(TH.menu_hl_text, TH.menu_hl_bg);
+    } else {
+      spr.setTextColor(TH.menu_item, TH.menu_bg);
+    }
+
+    spr.setTextDatum(MC_DATUM);
+    spr.drawString(text, 40+x+(sx/2), 64+y+(i*16), 2);
+  }
+}
+
 static void drawVolume(int x, int y, int sx)
 {
   drawCommon(menu[MENU_VOLUME], x, y, sx);
@@ -1661,10 +1815,12 @@ void drawSideBar(uint16_t cmd, int x, int y, int sx)
     case CMD_BRT:       drawBrt(x, y, sx);       break;
     case CMD_RDS:       drawRDSMode(x, y, sx);   break;
     case CMD_MEMORY:    drawMemory(x, y, sx);    break;
+    case CMD_STATIONS:  drawStations(x, y, sx);  break;
     case CMD_SLEEP:     drawSleep(x, y, sx);     break;
     case CMD_SLEEPMODE: drawSleepMode(x, y, sx); break;
     case CMD_BLEMODE:   drawBleMode(x, y, sx);   break;
     case CMD_WIFIMODE:  drawWiFiMode(x, y, sx);  break;
+    case CMD_SCANMODE:  drawScanMode(x, y, sx);  break;
     case CMD_ZOOM:      drawZoom(x, y, sx);      break;
     case CMD_SCROLL:    drawScrollDir(x, y, sx); break;
     case CMD_UTCOFFSET: drawUTCOffset(x, y, sx); break;
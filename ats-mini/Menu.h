@@ -27,7 +27,8 @@
 #define CMD_MEMORY    0x1900 // |
 #define CMD_SEEK      0x1A00 // |
 #define CMD_SCAN      0x1B00 // |
-#define CMD_SQUELCH   0x1C00 //-+
+#define CMD_SQUELCH   0x1C00 // |
+#define CMD_STATIONS  0x1D00 //-+
 #define CMD_SETTINGS  0x2000 //-SETTINGS MODE starts here
 #define CMD_BRT       0x2100 // |
 #define CMD_CAL       0x2200 // |
@@ -43,16 +44,22 @@
 #define CMD_LOADEIBI  0x2C00 // |
 #define CMD_BLEMODE   0x2D00 // |
 #define CMD_WIFIMODE  0x2E00 // |
-#define CMD_ABOUT     0x2F00 //-+
+#define CMD_SCANMODE  0x2F00 // |
+#define CMD_ABOUT     0x3000 //-+
 
 // UI Layouts
 #define UI_DEFAULT  0
 #define UI_SMETER   1
+#define UI_WATERFALL 2
 
 // Seek modes
 #define SEEK_DEFAULT  0
 #define SEEK_SCHEDULE 1
 
+// Scan modes
+#define SCAN_FIXED    0
+#define SCAN_ADAPTIVE 1
+
 //
 // Data Types
 //
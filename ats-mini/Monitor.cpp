@@ -0,0 +1,250 @@
+#include "Common.h"
+#include "Storage.h"
+#include "Utils.h"
+#include "Menu.h"
+
+#include <LittleFS.h>
+#include <FS.h>
+
+//
+// Unattended band monitor: on a timetable, sweeps a list of bands with
+// the scanner and appends each result to a rolling log on LittleFS, as
+// scan frames (see scanExport() and tools/scan.py). The log is rotated
+// into MONITOR_OLD once it grows past MONITOR_LOG_MAX, so at most two
+// logs worth of sweeps are kept. The display is never woken up.
+//
+#define MONITOR_LOG     "/monitor.log"
+#define MONITOR_OLD     "/monitor.old"
+#define MONITOR_LOG_MAX 131072 // Log size that triggers rotation (bytes)
+#define MONITOR_STEP    5      // Scan step, in band units
+#define MONITOR_SEGMENT 1000   // Frequency range of one scan at MONITOR_STEP
+#define MONITOR_MAX_BANDS 32   // Bands that fit into the band mask
+
+static uint16_t monitorInterval = 0;  // Minutes between sweeps, 0 = off
+static uint32_t monitorBands = 0;     // Bands to sweep, bit per band index
+static bool     monitorActive = false;
+static int      monitorBand = -1;     // Band being swept
+static uint16_t monitorSegment = 0;   // Start of the range being scanned
+static uint8_t  monitorSavedBand = 0; // Band to return to
+static int      monitorLastSlot = -1; // Last timetable slot swept
+static uint32_t monitorLastTime = 0;  // Last sweep time, without a clock
+
+bool monitorRunning()
+{
+  return(monitorActive);
+}
+
+uint16_t monitorGetInterval()
+{
+  return(monitorInterval);
+}
+
+uint32_t monitorGetBands()
+{
+  return(monitorBands);
+}
+
+// Default bands: all SW broadcast bands
+uint32_t monitorDefaultBands()
+{
+  uint32_t result = 0;
+
+  for(int j = 0 ; j < getTotalBands() && j < MONITOR_MAX_BANDS ; ++j)
+  {
+    const char *name = bands[j].bandName;
+    if(bands[j].bandType==SW_BAND_TYPE && bands[j].bandMode==AM && name[strlen(name)-1]=='M')
+      result |= 1UL << j;
+  }
+
+  return(result);
+}
+
+//
+// Set sweep interval (in minutes, 0 = off) and bands, saving them
+//
+void monitorSet(uint16_t interval, uint32_t bandMask)
+{
+  monitorInterval = interval < 24 * 60? interval : 24 * 60;
+  monitorBands    = bandMask;
+  monitorLastSlot = -1;
+  monitorLastTime = millis();
+
+  if(prefs.begin("monitor", false, STORAGE_PARTITION))
+  {
+    prefs.putUShort("Interval", monitorInterval);
+    prefs.putULong("Bands", monitorBands);
+    prefs.end();
+  }
+}
+
+//
+// Append the last scan to the log, rotating it when it gets too long
+//
+static void monitorLog()
+{
+  fs::File file = LittleFS.open(MONITOR_LOG, "a");
+  if(!file) return;
+
+  scanExport(file);
+  size_t size = file.size();
+  file.close();
+
+  if(size >= MONITOR_LOG_MAX)
+  {
+    LittleFS.remove(MONITOR_OLD);
+    LittleFS.rename(MONITOR_LOG, MONITOR_OLD);
+  }
+}
+
+//
+// Write the whole log, older part first, preceded by a
+// "[MONITOR] Log <size>" line
+//
+void monitorDumpLog(Stream &out)
+{
+  const char *paths[] = { MONITOR_OLD, MONITOR_LOG };
+  fs::File files[2];
+  size_t size = 0;
+
+  for(int j = 0 ; j < 2 ; ++j)
+  {
+    files[j] = LittleFS.open(paths[j], "rb");
+    if(files[j]) size += files[j].size();
+  }
+
+  out.printf("[MONITOR] Log %u\r\n", (unsigned int)size);
+
+  for(int j = 0 ; j < 2 ; ++j)
+  {
+    if(!files[j]) continue;
+
+    uint8_t buf[256];
+    for(size_t n ; (n = files[j].read(buf, sizeof(buf))) > 0 ; )
+      out.write(buf, n);
+    files[j].close();
+  }
+}
+
+//
+// Start scanning the next range of the current band, or the next
+// band. Returns FALSE when all bands are done.
+//
+static bool monitorNextScan()
+{
+  const Band *band = monitorBand >= 0? &bands[monitorBand] : NULL;
+
+  if(band && monitorSegment + MONITOR_SEGMENT < band->maximumFreq)
+  {
+    // Next range of the same band
+    monitorSegment += MONITOR_SEGMENT;
+  }
+  else
+  {
+    // Next band on the list
+    do monitorBand++;
+    while(monitorBand < getTotalBands() && monitorBand < MONITOR_MAX_BANDS && !(monitorBands & (1UL << monitorBand)));
+    if(monitorBand >= getTotalBands() || monitorBand >= MONITOR_MAX_BANDS) return(false);
+
+    // Switch bands quietly
+    selectBand(monitorBand, false);
+    monitorSegment = bands[monitorBand].minimumFreq;
+  }
+
+  // Scanner centers the range, clipping it to the band
+  scanStart(monitorSegment + MONITOR_SEGMENT / 2, MONITOR_STEP);
+  return(true);
+}
+
+//
+// Stop sweeping, returning to the original band. The audio stays
+// muted between scans and bands, tempMuteOn() ignoring unmute
+// requests while the monitor is running, and only comes back here.
+//
+void monitorStop()
+{
+  if(!monitorActive) return;
+
+  scanStop();
+  selectBand(monitorSavedBand, false);
+  monitorActive = false;
+
+  // Unmute the audio, unless squelch keeps it muted
+  if(!squelchCutoff) tempMuteOn(false);
+}
+
+//
+// Sweep all monitored bands now
+//
+void monitorStart()
+{
+  if(monitorActive || !monitorBands) return;
+
+  monitorSavedBand = bandIdx;
+  monitorBand = -1;
+  monitorActive = true;
+
+  if(!monitorNextScan()) monitorStop();
+}
+
+//
+// Check if it is time for the next sweep. With the clock set, sweeps
+// happen every monitorInterval minutes since midnight (UTC), i.e. at
+// the top of each hour for 60. Without it, every monitorInterval
+// minutes since the last one.
+//
+static bool monitorDue()
+{
+  if(!monitorInterval) return(false);
+
+  uint8_t hours, minutes;
+  if(clockGetHM(&hours, &minutes))
+  {
+    int slot = (hours * 60 + minutes) / monitorInterval;
+
+    // Do not sweep right after the clock gets set
+    if(monitorLastSlot < 0) monitorLastSlot = slot;
+    if(slot == monitorLastSlot) return(false);
+
+    monitorLastSlot = slot;
+    return(true);
+  }
+
+  if(millis() - monitorLastTime < monitorInterval * 60000UL) return(false);
+  monitorLastTime = millis();
+  return(true);
+}
+
+//
+// Run monitor sweeps, called from the main loop. Returns TRUE when
+// the screen needs to be redrawn.
+//
+bool monitorTickTime()
+{
+  if(monitorActive)
+  {
+    // Wait for the current scan to finish
+    if(scanRunning()) return(false);
+
+    monitorLog();
+    if(!monitorNextScan()) monitorStop();
+    return(true);
+  }
+
+  // Only start when the user is not doing anything
+  if(monitorDue() && currentCmd==CMD_NONE && !scanRunning()) monitorStart();
+  return(false);
+}
+
+void monitorInit()
+{
+  monitorBands = monitorDefaultBands();
+
+  if(prefs.begin("monitor", true, STORAGE_PARTITION))
+  {
+    monitorInterval = prefs.getUShort("Interval", monitorInterval);
+    monitorBands    = prefs.getULong("Bands", monitorBands);
+    prefs.end();
+  }
+
+  monitorLastTime = millis();
+}
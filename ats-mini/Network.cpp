@@ -53,6 +53,7 @@ AsyncWebServer server(80);
 // NTP Client to get time
 WiFiUDP ntpUDP;
 NTPClient ntpClient(ntpUDP, "pool.ntp.org");
+static volatile bool ntpTimeSet = false; // Client has time, see ntpGetTime()
 
 static bool wifiInitAP();
 static bool wifiConnect();
@@ -189,7 +190,11 @@ void netInit(uint8_t netMode, bool showStatus)
     if(netMode!=NET_SYNC && showStatus) delay(2000);
 
     // NTP time updates will happen every 5 minutes
-    ntpClient.setUpdateInterval(5*60*1000);
+    if(netLock())
+    {
+      ntpClient.setUpdateInterval(5*60*1000);
+      netUnlock();
+    }
 
     // Get NTP time from the network
     clockReset();
@@ -218,30 +223,55 @@ void netInit(uint8_t netMode, bool showStatus)
 }
 
 //
-// Returns TRUE if NTP time is available
+// Returns TRUE if NTP time is available. Does not wait for the lock,
+// which the network task holds for the whole ntpClient.update().
 //
 bool ntpIsAvailable()
 {
-  return(ntpClient.isTimeSet());
+  return(ntpTimeSet);
 }
 
 //
-// Update NTP time and synchronize clock with NTP time
+// Update and get NTP time (seconds since 1970), 0 if not available.
+// Also called from the network task, hence the lock.
 //
-bool ntpSyncTime()
+uint32_t ntpGetTime()
 {
-  if(WiFi.status()==WL_CONNECTED)
+  uint32_t result = 0;
+
+  if(WiFi.status()==WL_CONNECTED && netLock())
   {
     ntpClient.update();
-
-    if(ntpClient.isTimeSet())
-      return(clockSet(
-        ntpClient.getHours(),
-        ntpClient.getMinutes(),
-        ntpClient.getSeconds()
-      ));
+    if(ntpClient.isTimeSet()) result = ntpClient.getEpochTime();
+    // Once the client has time, it keeps it
+    if(result) ntpTimeSet = true;
+    netUnlock();
   }
-  return(false);
+
+  return(result);
+}
+
+//
+// Synchronize clock with given NTP time
+//
+bool ntpSetClock(uint32_t epoch)
+{
+  return(clockSet(
+    (epoch / 3600) % 24,
+    (epoch / 60) % 60,
+    epoch % 60,
+    (epoch / 86400 + 3) % 7,  // Weeks start on Monday, 1970-01-01 was Thursday
+    epoch / 86400
+  ));
+}
+
+//
+// Update NTP time and synchronize clock with NTP time
+//
+bool ntpSyncTime()
+{
+  uint32_t epoch = ntpGetTime();
+  return(epoch && ntpSetClock(epoch));
 }
 
 //
@@ -648,11 +678,15 @@ static const String webThemeSelector()
 
 static const String webRadioPage()
 {
+  // Runs in the web server task, use the published radio state
+  RadioState state;
+  radioGetState(&state);
+
   String ip = "";
   String ssid = "";
-  String freq = currentMode == FM?
-    String(currentFrequency / 100.0) + "MHz "
-  : String(currentFrequency + currentBFO / 1000.0) + "kHz ";
+  String freq = state.mode == FM?
+    String(state.freq / 100.0) + "MHz "
+  : String(state.freq + state.bfo / 1000.0) + "kHz ";
 
   if(WiFi.status()==WL_CONNECTED)
   {
@@ -685,19 +719,19 @@ static const String webRadioPage()
 "</TR>"
 "<TR>"
   "<TD CLASS='LABEL'>Band</TD>"
-  "<TD>" + String(getCurrentBand()->bandName) + "</TD>"
+  "<TD>" + String(bands[state.band].bandName) + "</TD>"
 "</TR>"
 "<TR>"
   "<TD CLASS='LABEL'>Frequency</TD>"
-  "<TD>" + freq + String(bandModeDesc[currentMode]) + "</TD>"
+  "<TD>" + freq + String(bandModeDesc[state.mode]) + "</TD>"
 "</TR>"
 "<TR>"
   "<TD CLASS='LABEL'>Signal Strength</TD>"
-  "<TD>" + String(rssi) + "dBuV</TD>"
+  "<TD>" + String(state.rssi) + "dBuV</TD>"
 "</TR>"
 "<TR>"
   "<TD CLASS='LABEL'>Signal to Noise</TD>"
-  "<TD>" + String(snr) + "dB</TD>"
+  "<TD>" + String(state.snr) + "dB</TD>"
 "</TR>"
 "<TR>"
   "<TD CLASS='LABEL'>Battery Voltage</TD>"
@@ -0,0 +1,319 @@
+#include "Common.h"
+#include "Utils.h"
+#include "Occupancy.h"
+
+#include <LittleFS.h>
+#include <FS.h>
+
+#define OCC_PATH "/occupancy.bin"
+#define OCC_TEMP "/occupancy.tmp"
+#define OCC_LOG  "/occupancy.log"
+
+#define OCC_BITS          16     // Hash table size, 1 << OCC_BITS cells
+#define OCC_MAX_CELLS     ((1 << OCC_BITS) * 3 / 4)
+#define OCC_EVICT_SCAN    32     // Cells looked at to find one to evict
+#define OCC_MEAN_SHIFT    4      // Running mean weight, 1 / (1 << OCC_MEAN_SHIFT)
+#define OCC_ACTIVE_SNR    6      // Minimal SNR for a signal to count as seen
+#define OCC_BATCH         64     // Samples per log write
+#define OCC_FLUSH_TIME    600000 // Max time samples wait in memory (msecs)
+#define OCC_LOG_MAX       65536  // Log size that triggers a new snapshot
+#define OCC_TUNED_TIME    60000  // Tuned frequency sampling interval (msecs)
+#define OCC_DEAD_SAMPLES  16     // Minimal samples before a channel can be dead
+#define OCC_DEAD_DAYS     14     // Days without signal for a channel to be dead
+#define OCC_RECHECK_EVERY 8      // Still measure every Nth dead channel
+
+static OccupancyCell *occCells = NULL;
+static uint32_t occCount = 0;
+static uint32_t occEvictPos = 0;
+
+// Samples waiting to be appended to the log
+static OccupancySample occBatch[OCC_BATCH];
+static int occBatchCount = 0;
+static uint32_t occFlushTime = 0;
+
+static uint32_t occRechecks = 0;
+
+// Cell key for the current time of day and mode
+static uint8_t occupancyKey()
+{
+  uint8_t hours, minutes;
+  uint8_t key = clockGetHM(&hours, &minutes)? hours : OCC_ANY_HOUR;
+  return(currentMode==FM? key | OCC_FM : key);
+}
+
+static inline uint32_t occupancyHash(uint16_t freq, uint8_t key)
+{
+  return(((uint32_t)(freq * 2654435761UL) ^ (key * 40503UL)) >> (32 - OCC_BITS));
+}
+
+//
+// Remove cell from the table, moving the following cells back into
+// the hole when their chains pass through it (linear probing)
+//
+static void occupancyRemove(uint32_t j)
+{
+  uint32_t mask = (1 << OCC_BITS) - 1;
+
+  for(uint32_t k = (j + 1) & mask ; occCells[k].freq ; k = (k + 1) & mask)
+  {
+    // Cell k can fill the hole if its chain starts at or before it
+    uint32_t home = occupancyHash(occCells[k].freq, occCells[k].key);
+    if(((k - home) & mask) >= ((k - j) & mask))
+    {
+      occCells[j] = occCells[k];
+      j = k;
+    }
+  }
+
+  memset(&occCells[j], 0, sizeof(OccupancyCell));
+  occCount--;
+}
+
+//
+// Make room in a full table by dropping the least sampled of the
+// next OCC_EVICT_SCAN cells, going round the table between calls.
+// Sweeps wider than the table then replace cells seen only a few
+// times, keeping the well established ones.
+//
+static void occupancyEvict()
+{
+  uint32_t mask = (1 << OCC_BITS) - 1;
+  uint32_t victim = 0;
+
+  for(int n = 0 ; n < OCC_EVICT_SCAN ; occEvictPos = (occEvictPos + 1) & mask)
+  {
+    const OccupancyCell *cell = &occCells[occEvictPos];
+    if(!cell->freq) continue;
+    if(!n++ || cell->count < occCells[victim].count) victim = occEvictPos;
+  }
+
+  occupancyRemove(victim);
+}
+
+//
+// Find cell for given frequency and key, optionally creating it,
+// evicting another cell when the table is full. Open addressing.
+//
+static OccupancyCell *occupancyCell(uint16_t freq, uint8_t key, bool create)
+{
+  if(!occCells || !freq) return(NULL);
+
+  uint32_t mask = (1 << OCC_BITS) - 1;
+  for(uint32_t j = occupancyHash(freq, key) ; ; j = (j + 1) & mask)
+  {
+    OccupancyCell *cell = &occCells[j];
+    if(cell->freq==freq && cell->key==key) return(cell);
+    if(cell->freq) continue;
+
+    // Empty cell, end of chain
+    if(!create) return(NULL);
+
+    // Eviction moves cells around, look again
+    if(occCount >= OCC_MAX_CELLS)
+    {
+      occupancyEvict();
+      return(occupancyCell(freq, key, create));
+    }
+    memset(cell, 0, sizeof(*cell));
+    cell->freq = freq;
+    cell->key  = key;
+    occCount++;
+    return(cell);
+  }
+}
+
+//
+// Fold a sample into cell statistics
+//
+static void occupancyFold(const OccupancySample *s)
+{
+  OccupancyCell *cell = occupancyCell(s->freq, s->key, true);
+  if(!cell) return;
+
+  if(!cell->count)
+  {
+    cell->min  = cell->max = s->rssi;
+    cell->mean = s->rssi << 8;
+  }
+  else
+  {
+    cell->min  = s->rssi < cell->min? s->rssi : cell->min;
+    cell->max  = s->rssi > cell->max? s->rssi : cell->max;
+    cell->mean += ((int32_t)(s->rssi << 8) - cell->mean) >> OCC_MEAN_SHIFT;
+  }
+
+  if(cell->count < 0xFFFF) cell->count++;
+  if(!cell->firstDay) cell->firstDay = s->day;
+
+  if(s->snr >= OCC_ACTIVE_SNR)
+  {
+    if(cell->active < 0xFF) cell->active++;
+    if(s->day) cell->lastSeen = s->day;
+  }
+}
+
+//
+// Write all cells into a new snapshot, dropping the log
+//
+static bool occupancySnapshot()
+{
+  fs::File file = LittleFS.open(OCC_TEMP, "w");
+  if(!file) return(false);
+
+  OccupancyHeader hdr = { OCC_MAGIC, OCC_VERSION, sizeof(OccupancyCell), occCount };
+  bool ok = file.write((uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr);
+
+  for(uint32_t j = 0 ; ok && j < (1 << OCC_BITS) ; ++j)
+    if(occCells[j].freq)
+      ok = file.write((uint8_t *)&occCells[j], sizeof(OccupancyCell)) == sizeof(OccupancyCell);
+
+  file.close();
+
+  // Replace old snapshot and log only once the new one is complete
+  if(!ok || !LittleFS.rename(OCC_TEMP, OCC_PATH))
+  {
+    LittleFS.remove(OCC_TEMP);
+    return(false);
+  }
+
+  LittleFS.remove(OCC_LOG);
+  return(true);
+}
+
+//
+// Append waiting samples to the log, making a new snapshot when the
+// log gets too long
+//
+void occupancyFlush()
+{
+  if(!occBatchCount) return;
+
+  fs::File file = LittleFS.open(OCC_LOG, "a");
+  if(file)
+  {
+    file.write((uint8_t *)occBatch, occBatchCount * sizeof(OccupancySample));
+    size_t size = file.size();
+    file.close();
+    if(size >= OCC_LOG_MAX) occupancySnapshot();
+  }
+
+  occBatchCount = 0;
+  occFlushTime = millis();
+}
+
+//
+// Add a sample at given frequency, in current band units
+//
+void occupancyAdd(uint16_t freq, uint8_t rssi, uint8_t snr)
+{
+  if(!occCells || !freq) return;
+
+  int32_t day = clockGetDay();
+  OccupancySample *s = &occBatch[occBatchCount++];
+  s->freq     = freq;
+  s->key      = occupancyKey();
+  s->rssi     = rssi;
+  s->snr      = snr;
+  s->reserved = 0;
+  s->day      = day > 0 && day <= 0xFFFF? day : 0;
+
+  occupancyFold(s);
+  if(occBatchCount >= OCC_BATCH) occupancyFlush();
+}
+
+//
+// Add a sample at the tuned frequency, once in OCC_TUNED_TIME
+//
+void occupancySample(uint16_t freq, uint8_t rssi, uint8_t snr)
+{
+  static uint32_t lastTime = 0;
+  static uint16_t lastFreq = 0;
+
+  if(freq==lastFreq && millis() - lastTime < OCC_TUNED_TIME) return;
+
+  lastFreq = freq;
+  lastTime = millis();
+  occupancyAdd(freq, rssi, snr);
+}
+
+//
+// Get statistics for given frequency at this hour of day
+//
+const OccupancyCell *occupancyGet(uint16_t freq)
+{
+  return(occupancyCell(freq, occupancyKey(), false));
+}
+
+//
+// Check if a channel has been dead long enough to be skipped: it has
+// OCC_DEAD_SAMPLES samples at this hour of day, spanning at least
+// OCC_DEAD_DAYS, and no signal for OCC_DEAD_DAYS, or none at all.
+// Repeated scans collect many samples quickly, so the count alone
+// says nothing. Without the date, no channel is dead. Every
+// OCC_RECHECK_EVERY dead channel is still reported as alive, so that
+// channels coming back to life get noticed.
+//
+bool occupancyDead(uint16_t freq)
+{
+  const OccupancyCell *cell = occupancyGet(freq);
+  if(!cell || cell->count < OCC_DEAD_SAMPLES || !cell->firstDay) return(false);
+
+  int32_t today = clockGetDay();
+  if(today <= 0 || today - cell->firstDay < OCC_DEAD_DAYS) return(false);
+
+  bool dead = cell->lastSeen?
+    today - cell->lastSeen >= OCC_DEAD_DAYS :
+    !cell->active;
+
+  return(dead && (occRechecks++ % OCC_RECHECK_EVERY));
+}
+
+//
+// Flush samples that waited in memory for too long
+//
+void occupancyTickTime()
+{
+  if(occBatchCount && millis() - occFlushTime >= OCC_FLUSH_TIME)
+    occupancyFlush();
+}
+
+//
+// Load snapshot and replay the log into memory
+//
+void occupancyInit()
+{
+  if(!occCells) occCells = (OccupancyCell *)ps_calloc(1 << OCC_BITS, sizeof(OccupancyCell));
+  if(!occCells) return;
+
+  fs::File file = LittleFS.open(OCC_PATH, "rb");
+  if(file)
+  {
+    OccupancyHeader hdr;
+    OccupancyCell cell;
+
+    if(file.read((uint8_t *)&hdr, sizeof(hdr)) == sizeof(hdr) &&
+       hdr.magic==OCC_MAGIC && hdr.version==OCC_VERSION &&
+       hdr.cellSize==sizeof(OccupancyCell))
+    {
+      for(uint32_t j = 0 ; j < hdr.count ; ++j)
+      {
+        if(file.read((uint8_t *)&cell, sizeof(cell)) != sizeof(cell)) break;
+        OccupancyCell *dst = occupancyCell(cell.freq, cell.key, true);
+        if(dst) *dst = cell;
+      }
+    }
+
+    file.close();
+  }
+
+  file = LittleFS.open(OCC_LOG, "rb");
+  if(file)
+  {
+    OccupancySample s;
+    while(file.read((uint8_t *)&s, sizeof(s)) == sizeof(s))
+      occupancyFold(&s);
+    file.close();
+  }
+
+  occFlushTime = millis();
+}
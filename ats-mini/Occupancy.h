@@ -0,0 +1,56 @@
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+//
+// Band occupancy database. Scan points and tuned RSSI samples are
+// folded into per frequency, per hour of day statistics, kept in
+// PSRAM and persisted on LittleFS as:
+//   /occupancy.bin  OccupancyHeader + OccupancyCell[count] snapshot
+//   /occupancy.log  OccupancySample[] appended in batches since then
+// The log is folded into a new snapshot once it grows large enough.
+//
+#define OCC_MAGIC     0x5543434F // "OCCU"
+#define OCC_VERSION   2
+#define OCC_FM        0x80       // Cell key flag, FM frequency units
+#define OCC_ANY_HOUR  24         // Cell key hour, clock not set
+
+struct OccupancyHeader
+{
+  uint32_t magic;       // OCC_MAGIC
+  uint16_t version;     // OCC_VERSION
+  uint16_t cellSize;    // sizeof(OccupancyCell)
+  uint32_t count;       // Number of cells
+};
+
+struct OccupancyCell
+{
+  uint16_t freq;        // Frequency, in band units (0 = empty)
+  uint8_t  key;         // Hour of day (UTC) or OCC_ANY_HOUR, plus OCC_FM
+  uint8_t  min;         // Minimal RSSI
+  uint8_t  max;         // Maximal RSSI
+  uint8_t  active;      // Samples with a signal (saturating)
+  uint16_t mean;        // Running mean RSSI, 8.8 fixed point
+  uint16_t count;       // Samples (saturating)
+  uint16_t lastSeen;    // Day a signal was last seen (days since 1970, 0 = unknown)
+  uint16_t firstDay;    // Day of the first dated sample (days since 1970, 0 = unknown)
+};
+
+struct OccupancySample
+{
+  uint16_t freq;        // Frequency, in band units
+  uint8_t  key;         // Cell key
+  uint8_t  rssi;        // RSSI (dBuV)
+  uint8_t  snr;         // SNR (dB)
+  uint8_t  reserved;    // Always 0
+  uint16_t day;         // Days since 1970 (0 = unknown)
+};
+
+void occupancyInit();
+void occupancyAdd(uint16_t freq, uint8_t rssi, uint8_t snr);
+void occupancySample(uint16_t freq, uint8_t rssi, uint8_t snr);
+bool occupancyDead(uint16_t freq);
+const OccupancyCell *occupancyGet(uint16_t freq);
+void occupancyFlush();
+void occupancyTickTime();
+
+#endif // OCCUPANCY_H
@@ -0,0 +1,68 @@
+#include "Peaks.h"
+
+#include <stddef.h>
+
+//
+// Get peak prominence: how far RSSI at the flat top j..end rises
+// above the higher of the lowest points separating it from higher
+// ground on either side (or from the range edges).
+//
+static uint8_t peakProminence(const ScanPoint *points, int count, int j, int end)
+{
+  uint8_t top = points[j].rssi;
+  uint8_t baseL = top, baseR = top;
+  int k;
+
+  for(k = j - 1 ; k >= 0 && points[k].rssi <= top ; --k)
+    if(points[k].rssi < baseL) baseL = points[k].rssi;
+  for(k = end + 1 ; k < count && points[k].rssi <= top ; ++k)
+    if(points[k].rssi < baseR) baseR = points[k].rssi;
+
+  // Peaks at the range edges only have one side
+  if(!j) baseL = baseR;
+  if(end == count - 1) baseR = baseL;
+
+  return(top - (baseL > baseR? baseL : baseR));
+}
+
+// Peak order: more prominent first, then stronger, then lower frequency
+static bool peakBefore(const ScanPeak *a, const ScanPeak *b)
+{
+  if(a->prominence != b->prominence) return(a->prominence > b->prominence);
+  if(a->rssi != b->rssi) return(a->rssi > b->rssi);
+  return(a->freq < b->freq);
+}
+
+int findPeaks(const ScanPoint *points, int count, ScanPeak *peaks, int maxPeaks, uint8_t minProminence, uint8_t minSNR)
+{
+  int found = 0;
+
+  for(int j = 0 ; j < count ; ++j)
+  {
+    // Take flat tops as a whole, reporting their middle point
+    int end = j;
+    while(end + 1 < count && points[end + 1].rssi == points[j].rssi) end++;
+
+    bool rising  = !j || points[j - 1].rssi < points[j].rssi;
+    bool falling = end == count - 1 || points[end + 1].rssi < points[end].rssi;
+    int mid = (j + end) / 2;
+    int first = j;
+    j = end;
+
+    // Must be a local maximum, with a signal
+    if(!rising || !falling || points[mid].snr < minSNR) continue;
+
+    uint8_t prominence = peakProminence(points, count, first, end);
+    if(prominence < minProminence) continue;
+
+    ScanPeak peak = { points[mid].freq, points[mid].rssi, points[mid].snr, prominence, NULL };
+
+    // Insert into the ranked list, dropping the weakest peak when full
+    int k = found < maxPeaks? found++ : maxPeaks;
+    for( ; k > 0 && peakBefore(&peak, &peaks[k - 1]) ; --k)
+      if(k < maxPeaks) peaks[k] = peaks[k - 1];
+    if(k < maxPeaks) peaks[k] = peak;
+  }
+
+  return(found);
+}
@@ -0,0 +1,31 @@
+#ifndef PEAKS_H
+#define PEAKS_H
+
+#include <stdint.h>
+
+// Measured scan point
+struct ScanPoint
+{
+  uint16_t freq;        // Frequency, in band units
+  uint8_t  rssi;        // RSSI (dBuV)
+  uint8_t  snr;         // SNR (dB)
+};
+
+// Detected signal peak
+struct ScanPeak
+{
+  uint16_t freq;        // Frequency, in band units
+  uint8_t  rssi;        // RSSI at the peak (dBuV)
+  uint8_t  snr;         // SNR at the peak (dB)
+  uint8_t  prominence;  // RSSI above the higher of the two bases (dB)
+  const char *name;     // Station name, if known (UTF-8)
+};
+
+//
+// Find peaks in points sorted by frequency, strongest (most prominent)
+// first. Only depends on the C library, so that it can run on a host
+// against recorded scan data.
+//
+int findPeaks(const ScanPoint *points, int count, ScanPeak *peaks, int maxPeaks, uint8_t minProminence, uint8_t minSNR);
+
+#endif // PEAKS_H
@@ -4,6 +4,10 @@
 #include "Menu.h"
 #include "Draw.h"
 #include "AIGalGame.h"
+#include "EIBI.h"
+#include "Peaks.h"
+
+#define SCAN_SAVE_PEAKS 10  // Default number of scan peaks to save
 
 static uint32_t remoteTimer = millis();
 static uint8_t remoteSeqnum = 0;
@@ -294,6 +298,120 @@ void remotePrintStatus()
                 );
 }
 
+//
+// Print stations with given name that are on air now
+//
+static void remoteFindStation(const char *name)
+{
+  StationSchedule results[16];
+  uint8_t hour, minute;
+
+  if(!clockGetHM(&hour, &minute))
+  {
+    Serial.println("[EIBI] Clock not set");
+    return;
+  }
+
+  size_t count = eibiFind(name, hour, minute, results, ITEM_COUNT(results));
+  for(size_t j = 0 ; j < count ; ++j)
+  {
+    if(results[j].start_h < 0)
+      Serial.printf("[EIBI] %5u kHz  anytime    %-24s %-5s %s\r\n",
+        results[j].freq, results[j].name, results[j].lang, results[j].target);
+    else
+      Serial.printf("[EIBI] %5u kHz  %02d%02d-%02d%02d  %-24s %-5s %s\r\n",
+        results[j].freq, results[j].start_h, results[j].start_m,
+        results[j].end_h, results[j].end_m,
+        results[j].name, results[j].lang, results[j].target);
+  }
+
+  Serial.printf("[EIBI] Found %u\r\n", (unsigned int)count);
+}
+
+//
+// Print peaks found by the last scan, strongest first
+//
+static void remoteScanPeaks()
+{
+  ScanPeak peaks[32];
+  int count = scanGetPeaks(peaks, ITEM_COUNT(peaks));
+
+  for(int j = 0 ; j < count ; ++j)
+  {
+    uint32_t freq = freqToHz(peaks[j].freq, currentMode);
+    Serial.printf("[SCAN] #%02d %9.3f kHz %3u dBuV %3u dB +%u dB %s\r\n",
+      j + 1, freq / 1000.0, peaks[j].rssi, peaks[j].snr, peaks[j].prominence,
+      peaks[j].name? peaks[j].name : "");
+  }
+
+  Serial.printf("[SCAN] Found %d\r\n", count);
+}
+
+//
+// Configure band monitor from "EVERY <minutes>", "BANDS <names>|*",
+// "NOW" or "STOP", then print its state
+//
+static void remoteMonitor(const char *args)
+{
+  char names[128];
+  unsigned int interval;
+
+  if(sscanf(args, "EVERY %u", &interval)==1)
+    monitorSet(interval, monitorGetBands());
+  else if(sscanf(args, "BANDS %127s", names)==1)
+  {
+    uint32_t mask = 0;
+
+    if(!strcmp(names, "*"))
+      mask = monitorDefaultBands();
+    else
+    {
+      // Comma separated band names
+      for(char *name = strtok(names, ",") ; name ; name = strtok(NULL, ","))
+      {
+        int j;
+        for(j = 0 ; j < getTotalBands() && strcmp(bands[j].bandName, name) ; ++j);
+        if(j < getTotalBands() && j < 32) mask |= 1UL << j;
+        else Serial.printf("[MONITOR] No band %s\r\n", name);
+      }
+    }
+
+    monitorSet(monitorGetInterval(), mask);
+  }
+  else if(!strcmp(args, "NOW")) monitorStart();
+  else if(!strcmp(args, "STOP")) monitorStop();
+  else if(*args)
+  {
+    Serial.println("[MONITOR] Usage: MONITOR [EVERY <minutes> | BANDS <names>|* | NOW | STOP | LOG]");
+    return;
+  }
+
+  Serial.printf("[MONITOR] Every %u min, %s, bands:", monitorGetInterval(), monitorRunning()? "sweeping" : "idle");
+  for(int j = 0 ; j < getTotalBands() && j < 32 ; ++j)
+    if(monitorGetBands() & (1UL << j)) Serial.printf(" %s", bands[j].bandName);
+  Serial.println();
+}
+
+//
+// Set schedule filter from "<langs> <targets>", where either can be
+// a comma separated list of codes or "*" for any, then print it
+//
+static void remoteSetFilter(const char *args)
+{
+  char langs[32] = "", targets[32] = "";
+
+  if(*args)
+  {
+    sscanf(args, "%31s %31s", langs, targets);
+    eibiSetFilter(strcmp(langs, "*")? langs : "", strcmp(targets, "*")? targets : "");
+    identifyFrequency(currentFrequency + currentBFO / 1000);
+  }
+
+  Serial.printf("[EIBI] Filter: languages %s, targets %s\r\n",
+    *eibiGetFilter(false)? eibiGetFilter(false) : "*",
+    *eibiGetFilter(true)? eibiGetFilter(true) : "*");
+}
+
 //
 // Tick remote time, periodically printing status
 //
@@ -331,6 +449,62 @@ int remoteDoCommand(char key)
   else if(line.endsWith("SUM")) { galgameTriggerSummarize(); Serial.println("[GG] Summarize queued"); }
       return event; // no REMOTE_CHANGED to avoid radio redraw hijack
     }
+    if(line.startsWith("SCAN")) {
+      // Subcommands: PEAKS, SAVE [<count>], DUMP (binary frame, see
+      //              tools/scan.py), otherwise print scan rate and
+      //              the last RSSI settling curve
+      if(line.startsWith("SCAN DUMP")) {
+        if(!scanExport(Serial, "[SCAN] Frame")) Serial.println("[SCAN] No data");
+        return(event);
+      }
+      if(line.startsWith("SCAN PEAKS")) {
+        remoteScanPeaks();
+        return(event);
+      }
+      if(line.startsWith("SCAN SAVE")) {
+        int count = line.substring(9).toInt();
+        count = scanSavePeaks(count > 0? count : SCAN_SAVE_PEAKS);
+        Serial.printf("[SCAN] Saved %d\r\n", count);
+        return(event | REMOTE_CHANGED);
+      }
+      uint16_t times[32];
+      uint8_t rssi[32];
+      int stc, n = scanGetSettleCurve(times, rssi, ITEM_COUNT(times), &stc);
+      Serial.printf("[SCAN] Rate %.1f pt/s, settle %ums, tuned %dms\r\n",
+        scanGetRate(), scanGetSettleTime(), n? stc : 0);
+      for(int j = 0 ; j < n ; ++j)
+        Serial.printf("[SCAN] %3ums %3u dBuV\r\n", times[j], rssi[j]);
+      return(event);
+    }
+    if(line.startsWith("MONITOR")) {
+      // Subcommands: LOG (binary scan frames, see tools/scan.py),
+      //              otherwise see remoteMonitor()
+      if(line.startsWith("MONITOR LOG")) monitorDumpLog(Serial);
+      else {
+        String args = line.substring(7); args.trim();
+        remoteMonitor(args.c_str());
+      }
+      return(event | REMOTE_CHANGED);
+    }
+    if(line.startsWith("EIBI")) {
+      // Subcommands: UPLOAD <size> <crc32 in hex>, followed by raw schedule image
+      //              FIND <station name>
+      //              FILTER [<languages>|* [<targets>|*]]
+      unsigned int size, crc;
+      if(sscanf(line.c_str(), "EIBI UPLOAD %u %x", &size, &crc)==2) {
+        Serial.println("[EIBI] Ready");
+        Serial.println(eibiReceiveSchedule(Serial, size, crc)? "[EIBI] OK" : "[EIBI] Failed");
+        return(event | REMOTE_CHANGED);
+      }
+      else if(line.startsWith("EIBI FIND ")) remoteFindStation(line.substring(10).c_str());
+      else if(line.startsWith("EIBI FILTER")) {
+        String args = line.substring(11); args.trim();
+        remoteSetFilter(args.c_str());
+        return(event | REMOTE_CHANGED);
+      }
+      else Serial.println("[EIBI] Usage: EIBI UPLOAD <size> <crc32> | EIBI FIND <name> | EIBI FILTER <langs> <targets>");
+      return(event);
+    }
   }
 
   switch(key)
@@ -1,69 +1,260 @@
 #include "Common.h"
 #include "Utils.h"
 #include "Menu.h"
+#include "Storage.h"
+#include "EIBI.h"
+#include "Occupancy.h"
+#include "Peaks.h"
+
+#include <esp_rom_crc.h>
 
 // Tuning delays after rx.setFrequency()
 #define TUNE_DELAY_DEFAULT 30
 #define TUNE_DELAY_FM      60
 #define TUNE_DELAY_AM_SSB  80
 
-#define SCAN_POLL_TIME    10 // Tuning status polling interval (msecs)
+#define SCAN_POLL_TIME     2 // Tuning status polling interval (msecs)
+#define SCAN_DRAW_TIME   100 // Minimal interval between redraws (msecs)
 #define SCAN_POINTS      200 // Number of frequencies to scan
 
+// Adaptive scan: coarse sweep, then finer passes around maxima
+#define SCAN_COARSE        4 // Coarse sweep step, in fixed scan steps
+#define SCAN_ADAPT_POINTS 90 // Adaptive scan budget (tuning cycles)
+#define SCAN_ADAPT_TIME 8000 // Adaptive scan budget (msecs)
+
+// Settle time learning: RSSI is read every SCAN_POLL_TIME after the
+// tuning completes, until it stays within SCAN_SETTLE_DB for
+// SCAN_SETTLE_READS readings. Learned settle times are then used for
+// SCAN_LEARN_EVERY points, after which they are measured again.
+#define SCAN_SETTLE_DB     1
+#define SCAN_SETTLE_READS  2
+#define SCAN_LEARN_EVERY  16
+#define SCAN_CURVE_POINTS 32
+
+// Waterfall history: last SCAN_HISTORY sweeps, resampled to the fixed
+// scan grid and kept in PSRAM. The average trace covers these sweeps,
+// the max-hold trace everything since the grid last changed.
+#define SCAN_HISTORY      64
+
+// Peak detection thresholds
+#define SCAN_PEAK_PROMINENCE 6 // Minimal RSSI rise above surroundings (dB)
+#define SCAN_PEAK_SNR        6 // Minimal SNR at the peak (dB)
+
+// Point measurement phases
+#define PHASE_TUNE   0  // Waiting for tuning to complete
+#define PHASE_LEARN  1  // Recording RSSI curve until it settles
+#define PHASE_SETTLE 2  // Waiting for the learned settle time
+
 #define SCAN_OFF    0   // Scanner off, no data
-#define SCAN_RUN    1   // Scanner running
+#define SCAN_RUN    1   // Scanner running, partial data in scanData[]
 #define SCAN_DONE   2   // Scanner done, valid data in scanData[]
 
-static struct
+//
+// Scan export frame, little endian, decoded by tools/scan.py:
+//   ScanFrameHeader
+//   { uint16_t freq; } uint8_t rssi; uint8_t snr;  (count times, freq
+//                                                   with SCAN_FRAME_FREQS)
+//   uint32_t crc     (CRC32 of everything above)
+//
+#define SCAN_FRAME_MAGIC   0x4E414353 // "SCAN"
+#define SCAN_FRAME_VERSION 1
+#define SCAN_FRAME_FM      0x01 // Frequencies in 10kHz units, else kHz
+#define SCAN_FRAME_FREQS   0x02 // Points not on the step grid, with frequencies
+
+struct __attribute__((packed)) ScanFrameHeader
 {
-  uint8_t rssi;
-  uint8_t snr;
-} scanData[SCAN_POINTS];
+  uint32_t magic;       // SCAN_FRAME_MAGIC
+  uint8_t  version;     // SCAN_FRAME_VERSION
+  uint8_t  flags;       // SCAN_FRAME_FM, SCAN_FRAME_FREQS
+  uint8_t  band;        // Band index
+  uint8_t  mode;        // Modulation
+  uint16_t startFreq;   // First point frequency
+  uint16_t step;        // Scan step
+  uint16_t count;       // Number of points
+  uint16_t reserved;    // Always 0
+  uint32_t time;        // Scan end, UTC seconds since 1970 (0 = unknown)
+  uint32_t uptime;      // Scan end, msecs since power on
+};
+
+// Measured points, sorted by frequency
+static ScanPoint scanData[SCAN_POINTS];
+
+// Graph heights, at SCAN_GRAPH_UNIT steps from scanGraphFreq
+#define SCAN_GRAPH_POINTS (SCAN_POINTS + 1)
+static uint8_t  scanGraphRSSI[SCAN_GRAPH_POINTS];
+static uint8_t  scanGraphSNR[SCAN_GRAPH_POINTS];
+static uint16_t scanGraphFreq = 0;
+static int      scanGraphCount = 0;
+static bool     scanGraphDirty = true;
 
 static uint32_t scanTime = millis();
+static uint32_t scanDrawTime = 0;
+static uint32_t scanBeginTime = 0;
+static uint32_t scanEndTime = 0;
+static uint32_t scanTuneTime = 0;
+static uint16_t scanWait = 0;
 static uint8_t  scanStatus = SCAN_OFF;
+static uint8_t  scanPhase = PHASE_TUNE;
+static uint8_t  scanStable = 0;
+static uint16_t scanLearned = 0;
+static bool     scanAdaptive = false;
+static bool     scanCoarse = false;
+static bool     scanRepeat = false;
 
 static uint16_t scanStartFreq;
+static uint16_t scanEndFreq;
+static uint16_t scanFreq;
 static uint16_t scanStep;
+static uint16_t scanMinGap;
 static uint16_t scanCount;
+static uint16_t scanDelay;
+static uint16_t scanSavedFreq;
+static uint8_t  scanBandIdx;          // Band and mode the data was scanned in,
+static uint8_t  scanRadioMode;        // bandIdx/currentMode may change since
 static uint8_t  scanMinRSSI;
 static uint8_t  scanMaxRSSI;
 static uint8_t  scanMinSNR;
 static uint8_t  scanMaxSNR;
 
+// Learned settle times (msecs after tuning), per band and mode
+static uint16_t *scanSettle = NULL;
+
+// Last recorded RSSI settling curve
+static struct
+{
+  uint16_t time;        // Time since tuning (msecs)
+  uint8_t  rssi;        // RSSI at that time
+} scanCurve[SCAN_CURVE_POINTS];
+static int scanCurveCount = 0;
+static int scanCurveStc = 0;
+
+// Sweep history ring, newest row at scanHistoryHead
+static uint8_t  *scanHistory = NULL;  // SCAN_HISTORY x SCAN_POINTS RSSI
+static uint8_t  *scanMaxHold = NULL;  // Max RSSI per grid point
+static uint16_t *scanSum = NULL;      // Sum of RSSI in the ring per grid point
+static uint32_t scanSweeps = 0;       // Sweeps added since start
+static uint16_t scanHistoryStart = 0; // Grid of history rows
+static uint16_t scanHistoryStep = 0;
+static int      scanHistoryHead = 0;
+static int      scanHistoryCount = 0;
+static uint8_t  scanHistoryMin = 255;
+static uint8_t  scanHistoryMax = 0;
+
 static inline uint8_t min(uint8_t a, uint8_t b) { return(a<b? a:b); }
 static inline uint8_t max(uint8_t a, uint8_t b) { return(a>b? a:b); }
 
-float scanGetRSSI(uint16_t freq)
+bool scanRunning()
 {
-  // Input frequency must be in range of existing data
-  if((scanStatus!=SCAN_DONE) || (freq<scanStartFreq) || (freq>=scanStartFreq+scanStep*scanCount))
-    return(0.0);
+  return(scanStatus==SCAN_RUN);
+}
 
-  uint8_t result = scanData[(freq - scanStartFreq) / scanStep].rssi;
-  return((result - scanMinRSSI) / (float)(scanMaxRSSI - scanMinRSSI + 1));
+//
+// Find the first point at or above the given frequency
+//
+static int scanFind(uint16_t freq)
+{
+  int l = 0, r = scanCount;
+
+  while(l < r)
+  {
+    int m = (l + r) >> 1;
+    if(scanData[m].freq < freq) l = m + 1; else r = m;
+  }
+
+  return(l);
 }
 
-float scanGetSNR(uint16_t freq)
+//
+// Get RSSI or SNR at given frequency, interpolating between the
+// nearest measured points. Returns -1 outside of measured range.
+//
+static float scanValue(uint16_t freq, bool snr)
+{
+  // Input frequency must be in range of existing (possibly partial) data
+  if((scanStatus==SCAN_OFF) || !scanCount) return(-1.0);
+  if((freq<scanData[0].freq) || (freq>scanData[scanCount-1].freq)) return(-1.0);
+
+  int j = scanFind(freq);
+  float b = snr? scanData[j].snr : scanData[j].rssi;
+  if(scanData[j].freq==freq) return(b);
+
+  float a = snr? scanData[j-1].snr : scanData[j-1].rssi;
+  return(a + (b - a) * (freq - scanData[j-1].freq) / (scanData[j].freq - scanData[j-1].freq));
+}
+
+//
+// Fill graph table with heights of RSSI or SNR curve, in pixels, at
+// every SCAN_GRAPH_UNIT from scanGraphFreq. Walks the points once,
+// interpolating in 8.8 fixed point.
+//
+static void scanGraphCurve(uint8_t *heights, bool snr)
+{
+  uint8_t lo = snr? scanMinSNR : scanMinRSSI;
+  int32_t range = ((snr? scanMaxSNR : scanMaxRSSI) - lo + 1) << 8;
+  int j = 0;
+
+  for(int k = 0 ; k < scanGraphCount ; ++k)
+  {
+    uint16_t freq = scanGraphFreq + k * SCAN_GRAPH_UNIT;
+    while(scanData[j].freq < freq) j++;
+
+    int32_t b = (snr? scanData[j].snr : scanData[j].rssi) << 8;
+    if(scanData[j].freq > freq)
+    {
+      int32_t a = (snr? scanData[j-1].snr : scanData[j-1].rssi) << 8;
+      b = a + (b - a) * (freq - scanData[j-1].freq) / (scanData[j].freq - scanData[j-1].freq);
+    }
+
+    heights[k] = (b - (lo << 8)) * SCAN_GRAPH_HEIGHT / range;
+  }
+}
+
+//
+// Get RSSI or SNR graph: heights in pixels (0..SCAN_GRAPH_HEIGHT) at
+// every SCAN_GRAPH_UNIT starting with the returned frequency. Tables
+// are only rebuilt when new points come in.
+//
+const uint8_t *scanGetGraph(bool snr, uint16_t *freq, int *count)
 {
-  // Input frequency must be in range of existing data
-  if((scanStatus!=SCAN_DONE) || (freq<scanStartFreq) || (freq>=scanStartFreq+scanStep*scanCount))
-    return(0.0);
+  if(scanGraphDirty)
+  {
+    scanGraphDirty = false;
+    scanGraphCount = 0;
+
+    if(scanStatus!=SCAN_OFF && scanCount)
+    {
+      // Cover measured range, at multiples of SCAN_GRAPH_UNIT
+      scanGraphFreq  = (scanData[0].freq + SCAN_GRAPH_UNIT - 1) / SCAN_GRAPH_UNIT * SCAN_GRAPH_UNIT;
+      scanGraphCount = scanData[scanCount-1].freq < scanGraphFreq? 0 :
+        (scanData[scanCount-1].freq - scanGraphFreq) / SCAN_GRAPH_UNIT + 1;
+      scanGraphCount = scanGraphCount < SCAN_GRAPH_POINTS? scanGraphCount : SCAN_GRAPH_POINTS;
 
-  uint8_t result = scanData[(freq - scanStartFreq) / scanStep].snr;
-  return((result - scanMinSNR) / (float)(scanMaxSNR - scanMinSNR + 1));
+      scanGraphCurve(scanGraphRSSI, false);
+      scanGraphCurve(scanGraphSNR, true);
+    }
+  }
+
+  *freq  = scanGraphFreq;
+  *count = scanGraphCount;
+  return(snr? scanGraphSNR : scanGraphRSSI);
 }
 
-static void scanInit(uint16_t centerFreq, uint16_t step)
+static void scanInit(uint16_t centerFreq, uint16_t step, bool adaptive)
 {
-  scanStep    = step;
-  scanCount   = 0;
-  scanMinRSSI = 255;
-  scanMaxRSSI = 0;
-  scanMinSNR  = 255;
-  scanMaxSNR  = 0;
-  scanStatus  = SCAN_RUN;
-  scanTime    = millis();
+  scanStep     = step;
+  scanCount    = 0;
+  scanMinRSSI  = 255;
+  scanMaxRSSI  = 0;
+  scanMinSNR   = 255;
+  scanMaxSNR   = 0;
+  scanStatus   = SCAN_RUN;
+  scanAdaptive = adaptive;
+  scanCoarse   = adaptive;
+  scanTime     = scanBeginTime = millis();
+  scanGraphDirty = true;
+
+  // Adaptive scan refines down to half of the fixed step
+  scanMinGap = step > 1? step / 2 : 1;
 
   const Band *band = getCurrentBand();
   int freq = scanStep * (centerFreq / scanStep - SCAN_POINTS / 2);
@@ -74,84 +265,526 @@ static void scanInit(uint16_t centerFreq, uint16_t step)
   if(freq < band->minimumFreq)
     freq = band->minimumFreq;
   scanStartFreq = freq;
+  freq += scanStep * (SCAN_POINTS - 1);
+  scanEndFreq = freq < band->maximumFreq? freq : band->maximumFreq;
 
   // Clear scan data
   memset(scanData, 0, sizeof(scanData));
 }
 
-static bool scanTickTime()
+// Signal score used to find maxima
+static inline int scanScore(int j)
 {
-  // Scan must be on
-  if((scanStatus!=SCAN_RUN) || (scanCount>=SCAN_POINTS)) return(false);
+  return(scanData[j].rssi + scanData[j].snr);
+}
 
-  // Wait for the right time
-  if(millis() - scanTime < SCAN_POLL_TIME) return(true);
+//
+// Pick the next frequency for adaptive scan: first a coarse sweep
+// over the whole range, then bisecting gaps next to the strongest
+// local maximum that still has gaps wider than scanMinGap. Returns
+// 0 when there is nothing left to refine.
+//
+static uint16_t scanAdaptiveNext()
+{
+  // Coarse sweep, until it reaches the end of the range
+  if(scanCoarse)
+  {
+    int freq = scanFreq + scanStep * SCAN_COARSE;
+    if(scanFreq < scanEndFreq) return(freq < scanEndFreq? freq : scanEndFreq);
+    scanCoarse = false;
+  }
 
-  // This is our current frequency to scan
-  uint16_t freq = scanStartFreq + scanStep * scanCount;
+  int best = -1, bestScore = -1;
 
-  // Poll for the tuning status
-  rx.getStatus(0, 0);
-  if(!rx.getTuneCompleteTriggered())
+  for(int j = 0 ; j < scanCount ; ++j)
   {
-    scanTime = millis();
-    return(true);
+    int score = scanScore(j);
+    bool left  = j > 0 && scanData[j].freq - scanData[j-1].freq > scanMinGap;
+    bool right = j < scanCount-1 && scanData[j+1].freq - scanData[j].freq > scanMinGap;
+
+    // Must be a local maximum with something left to refine
+    if((j > 0 && scanScore(j-1) > score) || (j < scanCount-1 && scanScore(j+1) > score)) continue;
+    if((left || right) && score > bestScore)
+    {
+      best = j;
+      bestScore = score;
+    }
   }
 
-  // If frequency not yet set, set it and wait until next call to measure
-  if(rx.getCurrentFrequency() != freq)
+  if(best < 0) return(0);
+
+  // Bisect the wider gap, or the one towards the stronger neighbour
+  int gapL = best > 0? scanData[best].freq - scanData[best-1].freq : 0;
+  int gapR = best < scanCount-1? scanData[best+1].freq - scanData[best].freq : 0;
+  bool goLeft = gapL > scanMinGap && (gapL > gapR || gapR <= scanMinGap ||
+    (gapL == gapR && scanScore(best-1) >= scanScore(best+1)));
+
+  return(goLeft?
+    scanData[best].freq - gapL / 2 :
+    scanData[best].freq + gapR / 2);
+}
+
+// Get learned settle time slot for the current band and mode
+static uint16_t *scanSettleSlot()
+{
+  if(!scanSettle) scanSettle = (uint16_t *)calloc(getTotalBands() * 4, sizeof(uint16_t));
+  return(scanSettle? &scanSettle[bandIdx * 4 + currentMode] : NULL);
+}
+
+// Get learned settle time for the current band and mode (0 if none)
+uint16_t scanGetSettleTime()
+{
+  uint16_t *slot = scanSettleSlot();
+  return(slot? *slot : 0);
+}
+
+//
+// Get the last recorded RSSI settling curve: times since tuning
+// (msecs) and RSSI values. Also reports when tuning completed.
+// Returns the number of points.
+//
+int scanGetSettleCurve(uint16_t *times, uint8_t *rssi, int maxCount, int *stcTime)
+{
+  int n = scanCurveCount < maxCount? scanCurveCount : maxCount;
+
+  for(int j = 0 ; j < n ; ++j)
   {
-    rx.setFrequency(freq); // Implies tuning delay
-    scanTime = millis() - SCAN_POLL_TIME;
-    return(true);
+    times[j] = scanCurve[j].time;
+    rssi[j]  = scanCurve[j].rssi;
+  }
+
+  if(stcTime) *stcTime = scanCurveStc;
+  return(n);
+}
+
+// Get the scan rate, in points per second
+float scanGetRate()
+{
+  if(scanStatus==SCAN_OFF || !scanCount) return(0.0);
+
+  uint32_t elapsed = (scanStatus==SCAN_RUN? millis() : scanEndTime) - scanBeginTime;
+  return(elapsed? scanCount * 1000.0 / elapsed : 0.0);
+}
+
+//
+// Add finished sweep to the history, resampling it to the fixed scan
+// grid. The history is cleared when the grid changes. Average and
+// max-hold traces are updated in place, without going over old rows.
+//
+static void scanHistoryAdd()
+{
+  if(!scanHistory)
+  {
+    scanHistory = (uint8_t *)ps_malloc(SCAN_HISTORY * SCAN_POINTS);
+    scanMaxHold = (uint8_t *)ps_malloc(SCAN_POINTS);
+    scanSum     = (uint16_t *)ps_malloc(SCAN_POINTS * sizeof(uint16_t));
+
+    // Keep all or nothing, so that the buffers are only checked here
+    if(!scanHistory || !scanMaxHold || !scanSum)
+    {
+      free(scanHistory);
+      free(scanMaxHold);
+      free(scanSum);
+      scanHistory = scanMaxHold = NULL;
+      scanSum = NULL;
+      return;
+    }
+
+    scanHistoryStep = 0;
+  }
+
+  // New grid, start over
+  if(scanHistoryStart!=scanStartFreq || scanHistoryStep!=scanStep)
+  {
+    scanHistoryStart = scanStartFreq;
+    scanHistoryStep  = scanStep;
+    scanHistoryHead  = 0;
+    scanHistoryCount = 0;
+    scanHistoryMin   = 255;
+    scanHistoryMax   = 0;
+    memset(scanMaxHold, 0, SCAN_POINTS);
+    memset(scanSum, 0, SCAN_POINTS * sizeof(uint16_t));
+    // Skip a whole history, so that viewers redraw everything
+    scanSweeps += SCAN_HISTORY;
+  }
+
+  // Reuse the oldest row once the ring is full
+  scanHistoryHead = (scanHistoryHead + 1) % SCAN_HISTORY;
+  uint8_t *row = scanHistory + scanHistoryHead * SCAN_POINTS;
+  bool full = scanHistoryCount == SCAN_HISTORY;
+  if(!full) scanHistoryCount++;
+
+  for(int j = 0 ; j < SCAN_POINTS ; ++j)
+  {
+    float v = scanValue(scanHistoryStart + j * scanHistoryStep, false);
+    uint8_t rssi = v < 0.0? 0 : v + 0.5;
+
+    scanSum[j] += rssi - (full? row[j] : 0);
+    row[j] = rssi;
+    scanMaxHold[j] = max(scanMaxHold[j], rssi);
+    if(v >= 0.0)
+    {
+      scanHistoryMin = min(scanHistoryMin, rssi);
+      scanHistoryMax = max(scanHistoryMax, rssi);
+    }
+  }
+
+  scanSweeps++;
+}
+
+// Get grid point index for a frequency, -1 if off the grid
+static int scanHistoryPoint(uint16_t freq)
+{
+  if(!scanHistoryCount || freq < scanHistoryStart) return(-1);
+  int j = (freq - scanHistoryStart + scanHistoryStep / 2) / scanHistoryStep;
+  return(j < SCAN_POINTS? j : -1);
+}
+
+// Normalize RSSI to the range of values in the history
+static inline float scanHistoryLevel(float rssi)
+{
+  if(rssi <= scanHistoryMin) return(0.0);
+  return((rssi - scanHistoryMin) / (float)(scanHistoryMax - scanHistoryMin + 1));
+}
+
+// Get number of sweeps added so far, to detect new history rows
+uint32_t scanGetSweeps()
+{
+  return(scanSweeps);
+}
+
+// Get number of sweeps in the history
+int scanGetHistoryCount()
+{
+  return(scanHistoryCount);
+}
+
+//
+// Get normalized RSSI at given frequency from a past sweep, where age
+// 0 is the latest sweep. Returns -1 outside of the history.
+//
+float scanGetHistoryRSSI(int age, uint16_t freq)
+{
+  int j = scanHistoryPoint(freq);
+  if(j < 0 || age < 0 || age >= scanHistoryCount) return(-1.0);
+
+  int row = (scanHistoryHead - age + SCAN_HISTORY) % SCAN_HISTORY;
+  return(scanHistoryLevel(scanHistory[row * SCAN_POINTS + j]));
+}
+
+// Get normalized max-hold RSSI at given frequency
+float scanGetMaxHold(uint16_t freq)
+{
+  int j = scanHistoryPoint(freq);
+  return(j < 0? 0.0 : scanHistoryLevel(scanMaxHold[j]));
+}
+
+// Get normalized average RSSI at given frequency
+float scanGetAverage(uint16_t freq)
+{
+  int j = scanHistoryPoint(freq);
+  return(j < 0? 0.0 : scanHistoryLevel(scanSum[j] / (float)scanHistoryCount));
+}
+
+//
+// Find peaks in the last scan, strongest first, with names of the
+// stations scheduled on air there when known
+//
+int scanGetPeaks(ScanPeak *peaks, int maxPeaks)
+{
+  if(scanStatus!=SCAN_DONE) return(0);
+
+  int n = findPeaks(scanData, scanCount, peaks, maxPeaks, SCAN_PEAK_PROMINENCE, SCAN_PEAK_SNR);
+
+  // Schedule uses kHz, not available for FM
+  uint8_t hour, minute;
+  if(scanRadioMode!=FM && clockGetHM(&hour, &minute))
+  {
+    for(int j = 0 ; j < n ; ++j)
+    {
+      const StationSchedule *schedule = eibiLookup(peaks[j].freq, hour, minute);
+      peaks[j].name = schedule? schedule->name : NULL;
+    }
+  }
+
+  return(n);
+}
+
+//
+// Save up to maxCount strongest peaks of the last scan into free
+// memory slots, skipping frequencies already in memory. Writes all
+// memories at once. Returns the number of peaks saved.
+//
+int scanSavePeaks(int maxCount)
+{
+  ScanPeak peaks[MEMORY_COUNT];
+  int n = scanGetPeaks(peaks, maxCount < MEMORY_COUNT? maxCount : MEMORY_COUNT);
+  int saved = 0, slot = 0;
+
+  for(int j = 0 ; j < n ; ++j)
+  {
+    uint32_t freq = freqToHz(peaks[j].freq, scanRadioMode);
+
+    // Skip frequencies that are already in memory
+    int k;
+    for(k = 0 ; k < getTotalMemories() ; ++k)
+      if(memories[k].freq==freq && memories[k].mode==scanRadioMode) break;
+    if(k < getTotalMemories()) continue;
+
+    // Find next free slot
+    while(slot < getTotalMemories() && memories[slot].freq) slot++;
+    if(slot >= getTotalMemories()) break;
+
+    memories[slot].freq = freq;
+    memories[slot].band = scanBandIdx;
+    memories[slot].mode = scanRadioMode;
+    snprintf(memories[slot].name, sizeof(memories[slot].name), "%s", peaks[j].name? peaks[j].name : "");
+    saved++;
+  }
+
+  if(saved) prefsSave(SAVE_MEMORIES);
+  return(saved);
+}
+
+//
+// Write the last finished scan as a binary frame, optionally
+// preceded by a "<label> <size>" line. Returns the frame size, or 0
+// if there is no finished scan.
+//
+size_t scanExport(Stream &out, const char *label)
+{
+  if(scanStatus!=SCAN_DONE || !scanCount) return(0);
+
+  ScanFrameHeader hdr = { SCAN_FRAME_MAGIC, SCAN_FRAME_VERSION, 0 };
+  hdr.flags     = scanRadioMode==FM? SCAN_FRAME_FM : 0;
+  hdr.band      = scanBandIdx;
+  hdr.mode      = scanRadioMode;
+  hdr.startFreq = scanData[0].freq;
+  hdr.step      = scanStep;
+  hdr.count     = scanCount;
+  hdr.uptime    = scanEndTime;
+
+  // Wall clock time, going back to when the scan ended
+  uint8_t hour, minute;
+  int32_t day = clockGetDay();
+  if(day >= 0 && clockGetHM(&hour, &minute))
+    hdr.time = (uint32_t)day * 86400 + hour * 3600 + minute * 60 - (millis() - scanEndTime) / 1000;
+
+  // Adaptive scans, and scans skipping dead channels, are off the grid
+  for(int j = 0 ; j < scanCount ; ++j)
+    if(scanData[j].freq != hdr.startFreq + j * scanStep) hdr.flags |= SCAN_FRAME_FREQS;
+
+  size_t size = sizeof(hdr) + scanCount * (hdr.flags & SCAN_FRAME_FREQS? 4 : 2) + sizeof(uint32_t);
+  if(label) out.printf("%s %u\r\n", label, (unsigned int)size);
+
+  out.write((uint8_t *)&hdr, sizeof(hdr));
+  uint32_t crc = esp_rom_crc32_le(0, (uint8_t *)&hdr, sizeof(hdr));
+
+  for(int j = 0 ; j < scanCount ; ++j)
+  {
+    uint8_t buf[4] = { (uint8_t)scanData[j].freq, (uint8_t)(scanData[j].freq >> 8) };
+    uint8_t *p = hdr.flags & SCAN_FRAME_FREQS? buf + 2 : buf;
+    p[0] = scanData[j].rssi;
+    p[1] = scanData[j].snr;
+    out.write(buf, p + 2 - buf);
+    crc = esp_rom_crc32_le(crc, buf, p + 2 - buf);
+  }
+
+  out.write((uint8_t *)&crc, sizeof(crc));
+  return(size);
+}
+
+//
+// Start tuning to the given frequency. There is no tuning delay in
+// rx.setFrequency() while scanning, scanTickTime() polls for the
+// tuning to complete instead.
+//
+static void scanTune(uint16_t freq)
+{
+  scanFreq = freq;
+  rx.setFrequency(freq);
+  scanTime = scanTuneTime = millis();
+  scanWait = SCAN_POLL_TIME;
+  scanPhase = PHASE_TUNE;
+}
+
+//
+// Finish scan, returning to the original frequency
+//
+void scanStop()
+{
+  if(scanStatus!=SCAN_RUN) return;
+  scanStatus = SCAN_DONE;
+  scanEndTime = millis();
+
+  // Restore current frequency
+  rx.setMaxDelaySetFrequency(scanDelay);
+  rx.setFrequency(scanSavedFreq);
+  // Unmute the audio, unless squelch keeps it muted
+  if(!squelchCutoff) tempMuteOn(false);
+  // Restore tuning delay
+  rx.setMaxDelaySetFrequency(TUNE_DELAY_DEFAULT);
+}
+
+//
+// Wait until RSSI settles after tuning. Returns TRUE once it does,
+// when current RSSI/SNR values can be used.
+//
+static bool scanSettled()
+{
+  uint16_t now = millis() - scanTuneTime;
+
+  switch(scanPhase)
+  {
+    case PHASE_TUNE:
+      // Poll for the tuning status, up to the worst case tuning delay
+      rx.getStatus(0, 0);
+      if(!rx.getTuneCompleteTriggered() && now < scanDelay) return(false);
+
+      // Learn settle time if not known or due for a check,
+      // otherwise wait for the learned settle time
+      if(!scanGetSettleTime() || !(scanLearned++ % SCAN_LEARN_EVERY))
+      {
+        scanPhase = PHASE_LEARN;
+        scanStable = 0;
+        scanCurveCount = 0;
+        scanCurveStc = now;
+      }
+      else scanPhase = PHASE_SETTLE;
+      return(false);
+
+    case PHASE_SETTLE:
+      if(now < scanGetSettleTime()) return(false);
+      rx.getCurrentReceivedSignalQuality();
+      return(true);
+
+    case PHASE_LEARN:
+    {
+      rx.getCurrentReceivedSignalQuality();
+
+      // Record RSSI curve, checking for stable values
+      if(scanCurveCount && abs(rx.getCurrentRSSI() - scanCurve[scanCurveCount-1].rssi) <= SCAN_SETTLE_DB)
+        scanStable++;
+      else
+        scanStable = 0;
+
+      if(scanCurveCount < SCAN_CURVE_POINTS)
+      {
+        scanCurve[scanCurveCount].time = now;
+        scanCurve[scanCurveCount].rssi = rx.getCurrentRSSI();
+        scanCurveCount++;
+      }
+
+      // Give up at the worst case tuning delay
+      if(scanStable < SCAN_SETTLE_READS && now < scanDelay) return(false);
+
+      // Average settle times, starting with the first one
+      uint16_t *slot = scanSettleSlot();
+      if(slot) *slot = *slot? (*slot * 3 + now + 2) / 4 : now;
+      return(true);
+    }
   }
 
-  // Measure RSSI/SNR values
-  rx.getCurrentReceivedSignalQuality();
-  scanData[scanCount].rssi = rx.getCurrentRSSI();
-  scanData[scanCount].snr  = rx.getCurrentSNR();
+  return(false);
+}
+
+//
+// Measure the next point of a running scan, if it is time to. Called
+// from the main loop, never blocks. Returns TRUE when there is new
+// data to draw.
+//
+bool scanTickTime()
+{
+  // Scan must be on
+  if(scanStatus!=SCAN_RUN) return(false);
+
+  // Wait for the right time
+  if(millis() - scanTime < scanWait) return(false);
+  scanTime = millis();
+
+  // Wait until tuned and settled
+  if(!scanSettled()) return(false);
+
+  // Insert new point, keeping points sorted by frequency
+  int j = scanFind(scanFreq);
+  memmove(&scanData[j+1], &scanData[j], (scanCount - j) * sizeof(scanData[0]));
+  scanCount++;
+
+  // Use RSSI/SNR values measured while settling
+  scanData[j].freq = scanFreq;
+  scanData[j].rssi = rx.getCurrentRSSI();
+  scanData[j].snr  = rx.getCurrentSNR();
 
   // Measure range of values
-  scanMinRSSI = min(scanData[scanCount].rssi, scanMinRSSI);
-  scanMaxRSSI = max(scanData[scanCount].rssi, scanMaxRSSI);
-  scanMinSNR  = min(scanData[scanCount].snr, scanMinSNR);
-  scanMaxSNR  = max(scanData[scanCount].snr, scanMaxSNR);
+  scanMinRSSI = min(scanData[j].rssi, scanMinRSSI);
+  scanMaxRSSI = max(scanData[j].rssi, scanMaxRSSI);
+  scanMinSNR  = min(scanData[j].snr, scanMinSNR);
+  scanMaxSNR  = max(scanData[j].snr, scanMaxSNR);
 
-  // Next frequency to scan
-  freq += scanStep;
+  // Graphs need to be rebuilt
+  scanGraphDirty = true;
 
-  // Set next frequency to scan or expire scan
-  if((++scanCount >= SCAN_POINTS) || !isFreqInBand(getCurrentBand(), freq) || checkStopSeeking())
-    scanStatus = SCAN_DONE;
+  // Record channel occupancy
+  occupancyAdd(scanFreq, scanData[j].rssi, scanData[j].snr);
+
+  // Next frequency to scan
+  uint16_t freq;
+  if(!scanAdaptive)
+  {
+    // Skip channels that have been dead for a long time
+    for(freq = scanFreq + scanStep ; freq <= scanEndFreq && occupancyDead(freq) ; freq += scanStep);
+  }
+  else if(scanCount >= SCAN_ADAPT_POINTS || millis() - scanBeginTime >= SCAN_ADAPT_TIME)
+    freq = 0;
   else
-    rx.setFrequency(freq); // Implies tuning delay
+    freq = scanAdaptiveNext();
 
-  // Save last scan time
-  scanTime = millis() - SCAN_POLL_TIME;
+  // Set next frequency to scan or finish scan
+  if(!freq || (scanCount >= SCAN_POINTS) || (freq > scanEndFreq) || !isFreqInBand(getCurrentBand(), freq))
+  {
+    scanHistoryAdd();
 
-  // Return current scan status
-  return(scanStatus==SCAN_RUN);
+    // Keep sweeping the same range if asked to
+    if(!scanRepeat)
+      scanStop();
+    else
+    {
+      scanInit(scanSavedFreq, scanStep, scanAdaptive);
+      scanTune(scanStartFreq);
+    }
+    return(true);
+  }
+
+  scanTune(freq);
+
+  // Draw partial results every now and then
+  if(millis() - scanDrawTime < SCAN_DRAW_TIME) return(false);
+  scanDrawTime = millis();
+  return(true);
 }
 
 //
-// Run entire scan once
+// Start scan around given frequency, either sweeping it with a fixed
+// step or adaptively. The main loop runs it, one point at a time, via
+// scanTickTime(). Repeating scan keeps sweeping until scanStop().
 //
-void scanRun(uint16_t centerFreq, uint16_t step)
+void scanStart(uint16_t centerFreq, uint16_t step, bool adaptive, bool repeat)
 {
-  // Set tuning delay
-  rx.setMaxDelaySetFrequency(currentMode == FM ? TUNE_DELAY_FM : TUNE_DELAY_AM_SSB);
+  // Stop any running scan first
+  scanStop();
+  // Tuning is polled by scanTickTime(), giving up after worst case delay
+  scanDelay = currentMode == FM ? TUNE_DELAY_FM : TUNE_DELAY_AM_SSB;
+  rx.setMaxDelaySetFrequency(0);
   // Mute the audio
   tempMuteOn(true);
-  // Flag is set by rotary encoder and cleared on seek/scan entry
-  seekStop = false;
-  // Save current frequency
-  uint16_t curFreq = rx.getFrequency();
-  // Scan the whole range
-  for(scanInit(centerFreq, step) ; scanTickTime(););
-  // Restore current frequency
-  rx.setFrequency(curFreq);
-  // Unmute the audio
-  tempMuteOn(false);
-  // Restore tuning delay
-  rx.setMaxDelaySetFrequency(TUNE_DELAY_DEFAULT);
+  // Save current frequency, band and mode
+  scanSavedFreq = rx.getFrequency();
+  scanBandIdx = bandIdx;
+  scanRadioMode = currentMode;
+  // Start with the first point
+  scanInit(centerFreq, step, adaptive);
+  scanRepeat = repeat;
+  scanDrawTime = millis();
+  scanLearned = 0;
+  scanTune(scanStartFreq);
 }
@@ -287,6 +287,24 @@ static const char *findNameByFreq(uint16_t freq, const NamedFreq *db, uint16_t d
   return(0);
 }
 
+//
+// Time until which the current schedule lookup result stays valid
+//
+static uint16_t schedule_freq = 0;
+static int schedule_time = -1;   // Time of the last lookup, in minutes
+static int schedule_valid = 0;   // Minutes the lookup result is valid for
+
+static bool scheduleIsValid(uint16_t freq)
+{
+  uint8_t hour, minute;
+
+  if(freq!=schedule_freq || !schedule_valid) return(false);
+  if(!clockGetHM(&hour, &minute)) return(false);
+
+  int elapsed = (hour * 60 + minute - schedule_time + 24 * 60) % (24 * 60);
+  return(elapsed < schedule_valid);
+}
+
 static const char *findScheduleByFreq(uint16_t freq, bool periodic)
 {
   uint8_t hour, minute;
@@ -323,6 +341,11 @@ static const char *findScheduleByFreq(uint16_t freq, bool periodic)
     last_offset = (size_t)-1;
     entry = eibiLookup(freq, hour, minute, &last_offset);
     first_offset = last_offset = entry ? last_offset : (size_t)-1;
+
+    // Find out how long this result stays the same
+    schedule_freq  = freq;
+    schedule_time  = hour * 60 + minute;
+    schedule_valid = eibiValidFor(freq, hour, minute);
   }
 
   // Return just the station name
@@ -340,6 +363,9 @@ bool identifyFrequency(uint16_t freq, bool periodic)
 
   // Do not try to look up static names more than once for the same freq
   if(periodic && last_freq==freq && name_found) return(false);
+
+  // Do not look up schedule again until the current result expires
+  if(periodic && last_freq==freq && scheduleIsValid(freq)) return(false);
   last_freq = freq;
   name_found = false;
 
@@ -47,7 +47,7 @@ bool prefsAreWritten()
 void prefsInvalidate()
 {
   static const char *sections[] =
-  { "settings", "memories", "bands", "network", 0 };
+  { "settings", "memories", "bands", "network", "monitor", 0 };
 
   // Clear all applicable sections
   for(int j = 0 ; sections[j] ; ++j)
@@ -183,6 +183,7 @@ void prefsSave(uint32_t items)
     prefs.putUChar("Theme",       themeIdx);       // Color theme
     prefs.putUChar("RDSMode",     rdsModeIdx);     // RDS mode
     prefs.putUChar("SleepMode",   sleepModeIdx);   // Sleep mode
+    prefs.putUChar("ScanMode",    scanModeIdx);    // Scan mode
     prefs.putUChar("ZoomMenu",    zoomMenu);       // TRUE: Zoom menu
     prefs.putBool("ScrollDir", scrollDirection<0); // TRUE: Reverse scroll
     prefs.putUChar("TuneHoldOff", tuneHoldOff);    // Tuning hold off
@@ -257,6 +258,7 @@ bool prefsLoad(uint32_t items)
     themeIdx       = prefs.getUChar("Theme", themeIdx);         // Color theme
     rdsModeIdx     = prefs.getUChar("RDSMode", rdsModeIdx);     // RDS mode
     sleepModeIdx   = prefs.getUChar("SleepMode", sleepModeIdx); // Sleep mode
+    scanModeIdx    = prefs.getUChar("ScanMode", scanModeIdx);   // Scan mode
     zoomMenu       = prefs.getUChar("ZoomMenu", zoomMenu);      // TRUE: Zoom menu
     scrollDirection = prefs.getBool("ScrollDir", scrollDirection<0)? -1:1; // TRUE: Reverse scroll
     tuneHoldOff    = prefs.getUChar("TuneHoldOff", tuneHoldOff); // Tuning hold off
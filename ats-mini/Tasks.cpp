@@ -0,0 +1,178 @@
+#include "Common.h"
+#include "Utils.h"
+#include "Menu.h"
+#include "EIBI.h"
+#include "AIGalGame.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+
+//
+// Slow network work (NTP, EiBi download, GalGame HTTP requests) runs
+// in a low priority task pinned to the core that already hosts the
+// WiFi stack, so that the Arduino loop() on the other core keeps
+// polling the radio and the encoder. Work is requested through
+// netQueue and results are passed back without locks, for loop() to
+// apply. Other tasks (network, web server) read the radio state from
+// a snapshot that loop() publishes, instead of globals it may be
+// changing.
+//
+#define NET_TASK_CORE     0    // Arduino loop() runs on core 1
+#define NET_TASK_PRIORITY 1    // Same as loop(), below WiFi and TCP/IP
+#define NET_TASK_STACK    8192 // Same as loop(), where HTTP used to run
+#define NET_QUEUE_SIZE    4    // Pending network requests
+
+static QueueHandle_t netQueue = NULL;
+static SemaphoreHandle_t netMutex = NULL;
+
+// NTP result, written by the network task and read by loop(),
+// odd ntpSeq means it is being written
+static volatile uint32_t ntpSeq = 0;      // Incremented by 2 per result
+static volatile uint32_t ntpEpoch = 0;    // NTP time (seconds since 1970)
+static volatile uint32_t ntpMillis = 0;   // millis() when NTP time was taken
+static uint32_t ntpSeqSeen = 0;
+
+// Radio state snapshot, odd radioSeq means it is being written
+static volatile uint32_t radioSeq = 0;
+static RadioState radioState;
+
+//
+// Serialize access to network clients shared between tasks
+//
+bool netLock()
+{
+  return(!netMutex || xSemaphoreTake(netMutex, portMAX_DELAY)==pdTRUE);
+}
+
+void netUnlock()
+{
+  if(netMutex) xSemaphoreGive(netMutex);
+}
+
+//
+// Network task: wait for requests and serve them one by one
+//
+static void netTask(void *param)
+{
+  uint8_t cmd;
+
+  for(;;)
+  {
+    if(xQueueReceive(netQueue, &cmd, portMAX_DELAY)!=pdTRUE) continue;
+
+    switch(cmd)
+    {
+      case NET_CMD_NTP:
+      {
+        uint32_t epoch = ntpGetTime();
+        if(!epoch) break;
+
+        // Same protocol as radioPublishState()
+        ntpSeq = ntpSeq + 1;
+        __sync_synchronize();
+        ntpEpoch  = epoch;
+        ntpMillis = millis();
+        __sync_synchronize();
+        ntpSeq = ntpSeq + 1;
+        break;
+      }
+
+      case NET_CMD_EIBI:
+        // Reports back through eibiTickTime()
+        eibiLoadSchedule();
+        break;
+
+      case NET_CMD_GALGAME:
+        // Reports back through galgameLoop()
+        galgameNetWork();
+        break;
+    }
+  }
+}
+
+//
+// Queue a request to the network task, without waiting
+//
+bool netRequest(uint8_t cmd)
+{
+  return(netQueue && xQueueSend(netQueue, &cmd, 0)==pdTRUE);
+}
+
+//
+// Set clock from the last NTP result, if there is a new one. Called
+// from loop(), returns TRUE when the screen needs to be redrawn.
+//
+bool ntpTickTime()
+{
+  uint32_t seq, epoch, time;
+
+  do
+  {
+    // Check again later if the network task is writing
+    seq = ntpSeq;
+    if((seq & 1) || seq == ntpSeqSeen) return(false);
+    __sync_synchronize();
+    epoch = ntpEpoch;
+    time  = ntpMillis;
+    __sync_synchronize();
+  }
+  while(seq != ntpSeq);
+
+  ntpSeqSeen = seq;
+
+  // Account for the time the result waited for us
+  return(ntpSetClock(epoch + (millis() - time) / 1000));
+}
+
+//
+// Publish current radio state for other tasks. Called from loop().
+//
+void radioPublishState()
+{
+  RadioState state;
+  state.freq = currentFrequency;
+  state.bfo  = currentBFO;
+  state.band = bandIdx;
+  state.mode = currentMode;
+  state.rssi = rssi;
+  state.snr  = snr;
+
+  // Only write when something changed
+  if(!memcmp(&state, &radioState, sizeof(state))) return;
+
+  radioSeq = radioSeq + 1;
+  __sync_synchronize();
+  radioState = state;
+  __sync_synchronize();
+  radioSeq = radioSeq + 1;
+}
+
+//
+// Get consistent copy of the radio state, from any task
+//
+void radioGetState(RadioState *state)
+{
+  uint32_t seq;
+
+  do
+  {
+    // Wait for the writer to finish
+    while((seq = radioSeq) & 1) taskYIELD();
+    __sync_synchronize();
+    *state = radioState;
+    __sync_synchronize();
+  }
+  while(seq != radioSeq);
+}
+
+void tasksInit()
+{
+  radioPublishState();
+
+  netMutex = xSemaphoreCreateMutex();
+  netQueue = xQueueCreate(NET_QUEUE_SIZE, sizeof(uint8_t));
+  if(netQueue)
+    xTaskCreatePinnedToCore(netTask, "net", NET_TASK_STACK, NULL, NET_TASK_PRIORITY, NULL, NET_TASK_CORE);
+}
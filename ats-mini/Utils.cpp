@@ -25,6 +25,8 @@ static uint32_t clockTimer  = 0;
 static uint8_t clockSeconds = 0;
 static uint8_t clockMinutes = 0;
 static uint8_t clockHours   = 0;
+static int8_t  clockWeekday = -1;  // 0 = Monday, -1 = unknown
+static int32_t clockDay     = -1;  // Days since 1970-01-01, -1 = unknown
 static char    clockText[8] = {0};
 
 //
@@ -123,6 +125,9 @@ bool muteOn(int x)
 //
 void tempMuteOn(bool x)
 {
+  // Monitor sweeps stay muted from start to finish, see monitorStop()
+  if(!x && monitorRunning()) return;
+
   if(!muteOn(2))
   {
     if(x)
@@ -247,12 +252,25 @@ bool clockGetHM(uint8_t *hours, uint8_t *minutes)
   }
 }
 
+// Returns UTC weekday (0 = Monday) or -1 if not known
+int clockGetWeekday()
+{
+  return(clockHasBeenSet? clockWeekday : -1);
+}
+
+int32_t clockGetDay()
+{
+  return(clockHasBeenSet? clockDay : -1);
+}
+
 void clockReset()
 {
   clockHasBeenSet = false;
   clockText[0] = '\0';
   clockTimer = 0;
   clockHours = clockMinutes = clockSeconds = 0;
+  clockWeekday = -1;
+  clockDay = -1;
 }
 
 static void formatClock(uint8_t hours, uint8_t minutes)
@@ -267,7 +285,7 @@ void clockRefreshTime()
   if(clockHasBeenSet) formatClock(clockHours, clockMinutes);
 }
 
-bool clockSet(uint8_t hours, uint8_t minutes, uint8_t seconds)
+bool clockSet(uint8_t hours, uint8_t minutes, uint8_t seconds, int8_t weekday, int32_t day)
 {
   // Verify input before setting clock
   if(!clockHasBeenSet && hours < 24 && minutes < 60 && seconds < 60)
@@ -277,6 +295,10 @@ bool clockSet(uint8_t hours, uint8_t minutes, uint8_t seconds)
     clockHours   = hours;
     clockMinutes = minutes;
     clockSeconds = seconds;
+    clockWeekday = weekday < 7? weekday : -1;
+    clockDay     = day;
+    // 1970-01-01 was a Thursday
+    if(clockWeekday < 0 && clockDay >= 0) clockWeekday = (clockDay + 3) % 7;
     clockRefreshTime();
     identifyFrequency(currentFrequency + currentBFO / 1000);
     return(true);
@@ -307,7 +329,10 @@ bool clockTickTime()
       {
         delta = clockMinutes / 60;
         clockMinutes -= delta * 60;
-        clockHours = (clockHours + delta) % 24;
+        delta += clockHours;
+        clockHours = delta % 24;
+        if(clockWeekday >= 0) clockWeekday = (clockWeekday + delta / 24) % 7;
+        if(clockDay >= 0) clockDay += delta / 24;
       }
 
       // Format clock for display and ask for screen update
@@ -25,7 +25,9 @@ void tempMuteOn(bool x);
 const char *clockGet();
 bool clockAvailable();
 bool clockGetHM(uint8_t *hours, uint8_t *minutes);
-bool clockSet(uint8_t hours, uint8_t minutes, uint8_t seconds = 0);
+bool clockSet(uint8_t hours, uint8_t minutes, uint8_t seconds = 0, int8_t weekday = -1, int32_t day = -1);
+int clockGetWeekday();
+int32_t clockGetDay();
 void clockReset();
 bool clockTickTime();
 void clockRefreshTime();
@@ -12,6 +12,7 @@
 #include "Themes.h"
 #include "Utils.h"
 #include "EIBI.h"
+#include "Occupancy.h"
 #include "AIGalGame.h"
 
 // SI473/5 and UI
@@ -23,6 +24,7 @@
 #define STRENGTH_CHECK_TIME   1500  // Not used
 #define RDS_CHECK_TIME         250  // Increased from 90
 #define SEEK_TIMEOUT        600000  // Max seek timeout (ms)
+#define SEEK_DEAD_SKIPS          8  // Max known dead channels skipped by one seek
 #define NTP_CHECK_TIME       60000  // NTP time refresh period (ms)
 #define SCHEDULE_CHECK_TIME   2000  // How often to identify the same frequency (ms)
 #define BACKGROUND_REFRESH_TIME 5000    // Background screen refresh time. Covers the situation where there are no other events causing a refresh
@@ -48,7 +50,8 @@ long lastNTPCheck = millis();
 long lastScheduleCheck = millis();
 
 long elapsedCommand = millis();
-volatile int encoderCount = 0;
+int encoderCount = 0;                   // Encoder detents to process
+int encoderTune = 0;                    // Same detents, scaled by rotation speed
 uint16_t currentFrequency;
 
 // AGC/ATTN index per mode (FM/AM/SSB)
@@ -192,6 +195,15 @@ void setup()
   // Initialize flash file system
   diskInit();
 
+  // Load EiBi schedule into memory, if present
+  eibiInit();
+
+  // Load band occupancy statistics
+  occupancyInit();
+
+  // Load band monitor timetable
+  monitorInit();
+
   // Check for SI4732 connected on I2C interface
   // If the SI4732 is not detected, then halt with no further processing
   rx.setI2CFastModeCustom(100000);
@@ -256,6 +268,9 @@ void setup()
   attachInterrupt(digitalPinToInterrupt(ENCODER_PIN_A), rotaryEncoder, CHANGE);
   attachInterrupt(digitalPinToInterrupt(ENCODER_PIN_B), rotaryEncoder, CHANGE);
 
+  // Start network task and publish initial radio state
+  tasksInit();
+
   // Connect WiFi, if necessary
   netInit(wifiModeIdx);
 
@@ -279,6 +294,96 @@ void setup()
   Serial.println("==========================================");
 }
 
+//
+// Encoder detents are queued by the interrupt handler and drained by
+// the main loop, so that none get lost while the loop is busy, e.g.
+// redrawing the screen. There is a single producer and a single
+// consumer: only the interrupt handler advances encoderHead and only
+// the main loop advances encoderTail. Both run on the same core. The
+// detents that do not fit into a full queue are summed in encoderLost.
+//
+#define ENCODER_QUEUE 64   // Queue length, must be a power of 2
+#define ENCODER_PAUSE 150  // Time between detents that resets rotation speed (ms)
+#define ENCODER_SPAN  8    // Accelerated tuning moves at most 1/ENCODER_SPAN of the band
+
+struct EncoderEvent
+{
+  uint32_t time;           // Detent time (ms)
+  int8_t dir;              // 1 = clockwise, -1 = counter-clockwise
+};
+
+static volatile EncoderEvent encoderQueue[ENCODER_QUEUE];
+static volatile uint32_t encoderHead = 0;
+static volatile uint32_t encoderTail = 0;
+static volatile int32_t encoderLost = 0;
+static int32_t encoderLostSeen = 0;
+
+// Tuning acceleration: step multiplier for a given detent rate (per second)
+static const struct { uint16_t rate; uint8_t scale; } encoderAccel[] =
+{
+  { 60, 50 }, { 40, 20 }, { 25, 5 }, { 15, 2 }, { 0, 1 }
+};
+
+static uint32_t encoderLastTime = 0;
+static int8_t encoderLastDir = 0;
+static uint16_t encoderInterval = ENCODER_PAUSE; // Smoothed time between detents (ms)
+
+//
+// Get step multiplier for a detent, from the smoothed rotation speed.
+// Changing direction or pausing starts over at the slowest speed.
+//
+static int encoderScale(uint32_t time, int8_t dir)
+{
+  uint32_t dt = time - encoderLastTime;
+
+  if(dir!=encoderLastDir || dt>=ENCODER_PAUSE)
+    encoderInterval = ENCODER_PAUSE;
+  else
+    encoderInterval = (encoderInterval * 3 + dt) / 4;
+
+  encoderLastTime = time;
+  encoderLastDir  = dir;
+
+  uint16_t rate = 1000 / (encoderInterval? encoderInterval : 1);
+  for(size_t j = 0 ; j < ITEM_COUNT(encoderAccel) ; ++j)
+    if(rate >= encoderAccel[j].rate) return(encoderAccel[j].scale);
+
+  return(1);
+}
+
+//
+// Add all queued detents to encoderCount and, scaled by rotation
+// speed, to encoderTune
+//
+static void encoderDrain()
+{
+  for(uint32_t head = encoderHead ; encoderTail != head ; encoderTail++)
+  {
+    volatile EncoderEvent *event = &encoderQueue[encoderTail & (ENCODER_QUEUE - 1)];
+    encoderCount += event->dir;
+    encoderTune  += event->dir * encoderScale(event->time, event->dir);
+  }
+
+  // Queue overflow, should not normally happen
+  int32_t lost = encoderLost - encoderLostSeen;
+  encoderLostSeen += lost;
+  encoderCount += lost;
+  encoderTune  += lost;
+
+  // Detents that cancelled each other out leave nothing to tune
+  if(!encoderCount) encoderTune = 0;
+}
+
+//
+// Drop all pending detents
+//
+static void encoderFlush()
+{
+  encoderTail = encoderHead;
+  encoderLostSeen = encoderLost;
+  encoderCount = encoderTune = 0;
+}
+
 //
 // Reads encoder via interrupt
 // Uses Rotary.h and Rotary.cpp implementation to process encoder via
@@ -292,7 +397,21 @@ ICACHE_RAM_ATTR void rotaryEncoder()
   uint8_t encoderStatus = encoder.process();
   if(encoderStatus)
   {
-    encoderCount = encoderStatus==DIR_CW? 1 : -1;
+    int8_t dir = encoderStatus==DIR_CW? 1 : -1;
+    uint32_t head = encoderHead;
+
+    // Publish the event before advancing the head
+    if(head - encoderTail < ENCODER_QUEUE)
+    {
+      encoderQueue[head & (ENCODER_QUEUE - 1)].time = millis();
+      encoderQueue[head & (ENCODER_QUEUE - 1)].dir  = dir;
+      encoderHead = head + 1;
+    }
+    else
+    {
+      encoderLost += dir;
+    }
+
     seekStop = true;
   }
 }
@@ -302,6 +421,9 @@ ICACHE_RAM_ATTR void rotaryEncoder()
 //
 void useBand(const Band *band)
 {
+  // Running scan belongs to the previous band
+  scanStop();
+
   // Set current frequency and mode, reset BFO
   currentFrequency = band->currentFreq;
   currentMode = band->bandMode;
@@ -477,6 +599,7 @@ bool checkStopSeeking()
     // Wait till the button is released, otherwise the main loop will register a click
     while(pb1.update(digitalRead(ENCODER_PUSH_BUTTON) == LOW).isPressed)
       delay(100);
+    seekStop = true;
     return true;
   }
 
@@ -532,7 +655,12 @@ bool doSeek(int8_t dir)
 
       // Flag is set by rotary encoder and cleared on seek/scan entry
       seekStop = false;
-      rx.seekStationProgress(showFrequencySeek, checkStopSeeking, dir>0? 1 : 0);
+      // Keep seeking past channels the occupancy database knows to be dead
+      for(int skips = 0 ; ; skips++)
+      {
+        rx.seekStationProgress(showFrequencySeek, checkStopSeeking, dir>0? 1 : 0);
+        if(seekStop || skips >= SEEK_DEAD_SKIPS || !occupancyDead(rx.getFrequency())) break;
+      }
       if(tuneHoldOff) tuning_flag = false;
       updateFrequency(rx.getFrequency(), true);
     }
@@ -561,11 +689,25 @@ bool doSeek(int8_t dir)
   return(true);
 }
 
+//
+// Limit accelerated tuning to a fraction of the band span, so that
+// a fast spin with a large step does not wrap around the band. A
+// single step is always allowed.
+//
+static int tuneLimit(int dir, int step, int span)
+{
+  int maxDir = max(1, span / ENCODER_SPAN / step);
+  return(constrain(dir, -maxDir, maxDir));
+}
+
 //
 // Handle tuning
 //
-bool doTune(int8_t dir, bool fast = false)
+bool doTune(int dir, bool fast = false)
 {
+  // Ignore idle encoder
+  if(!dir) return(false);
+
   //
   // SSB tuning
   //
@@ -578,11 +720,13 @@ bool doTune(int8_t dir, bool fast = false)
       tuning_timer = millis();
     }
 
-    uint32_t step = getCurrentStep(fast)->step;
-    uint32_t stepAdjust = (currentFrequency * 1000 + currentBFO) % step;
-    step = !stepAdjust? step : dir>0? step - stepAdjust : stepAdjust;
+    int step = getCurrentStep(fast)->step;
+    int stepAdjust = (currentFrequency * 1000 + currentBFO) % step;
+    const Band *band = getCurrentBand();
+    dir = tuneLimit(dir, step, (band->maximumFreq - band->minimumFreq) * 1000);
 
-    updateBFO(currentBFO + dir * step, true);
+    // First step snaps to the step grid
+    updateBFO(currentBFO + dir * step - (dir>0? stepAdjust : stepAdjust? stepAdjust - step : 0), true);
   }
 
   //
@@ -597,13 +741,14 @@ bool doTune(int8_t dir, bool fast = false)
       tuning_timer = millis();
     }
 
-    uint16_t step = getCurrentStep(fast)->step;
-    uint16_t stepAdjust = currentFrequency % step;
+    int step = getCurrentStep(fast)->step;
+    int stepAdjust = currentFrequency % step;
+    const Band *band = getCurrentBand();
+    dir = tuneLimit(dir, step, band->maximumFreq - band->minimumFreq);
     stepAdjust = (currentMode==FM) && (step==20)? (stepAdjust+10) % step : stepAdjust;
-    step = !stepAdjust? step : dir>0? step - stepAdjust : stepAdjust;
 
-    // Tune to a new frequency
-    updateFrequency(currentFrequency + step * dir, true);
+    // Tune to a new frequency, first step snapping to the step grid
+    updateFrequency(currentFrequency + dir * step - (dir>0? stepAdjust : stepAdjust? stepAdjust - step : 0), true);
   }
 
   // Clear current station name and information
@@ -730,6 +875,8 @@ bool processRssiSnr()
       snr = newSNR;
       needRedraw = true;
     }
+    // Record tuned frequency occupancy
+    occupancySample(currentFrequency + currentBFO / 1000, newRSSI, newSNR);
   }
   return needRedraw;
 }
@@ -753,10 +900,14 @@ void loop()
 
   ButtonTracker::State pb1st = pb1.update(digitalRead(ENCODER_PUSH_BUTTON) == LOW);
 
+  // Collect encoder detents queued since the last pass
+  encoderDrain();
+
   // If GalGame app is active, divert input & skip radio logic
   if(galgameActive()) {
-    // Map encoder and button events
-    int dir = encoderCount; encoderCount = 0;
+    // Map encoder and button events, one detent per pass
+    int dir = encoderCount>0? 1 : encoderCount<0? -1 : 0;
+    encoderCount -= dir; encoderTune = 0;
     galgameEncoder(dir, pb1st.wasClicked||pb1st.wasShortPressed, pb1st.isLongPressed, pb1st.wasShortPressed);
     galgameLoop();
     // Prevent display sleep & command timeout while in game
@@ -775,14 +926,34 @@ void loop()
     needRedraw |= !!(revent & REMOTE_CHANGED);
     pb1st.wasClicked |= !!(revent & REMOTE_CLICK);
     int direction = revent >> REMOTE_DIRECTION;
-    encoderCount = direction? direction : encoderCount;
+    encoderCount += direction;
+    encoderTune  += direction;
     if(revent & REMOTE_PREFS) prefsRequestSave(SAVE_ALL);
   }
 
   int ble_event = bleDoCommand(bleModeIdx);
 
+  // Rotation or click stops unattended band monitoring, returning
+  // to the original band, unless the encoder is locked. The input is
+  // passed on, so that a click still wakes up the display.
+  if(monitorRunning() && (pb1st.wasClicked || pb1st.wasShortPressed ||
+     (encoderCount && !(sleepOn() && sleepModeIdx==SLEEP_LOCKED))))
+  {
+    monitorStop();
+    needRedraw = true;
+  }
+
+  // Rotation or click stops a running scan, restoring frequency,
+  // and the click is not passed on
+  if(scanRunning() && (encoderCount || pb1st.wasClicked || pb1st.wasShortPressed))
+  {
+    scanStop();
+    pb1st.wasClicked = pb1st.wasShortPressed = false;
+    needRedraw = true;
+  }
+
   // Block encoder rotation when in the locked sleep mode
-  if(encoderCount && sleepOn() && sleepModeIdx==SLEEP_LOCKED) encoderCount = 0;
+  if(encoderCount && sleepOn() && sleepModeIdx==SLEEP_LOCKED) encoderCount = encoderTune = 0;
 
   // Activate push and rotate mode (can span multiple loop iterations until the button is released)
   if (encoderCount && pb1st.isPressed) pushAndRotate = true;
@@ -807,19 +978,19 @@ void loop()
           break;
         case CMD_SEEK:
           // Normal tuning in seek mode
-          needRedraw |= doTune(encoderCount);
+          needRedraw |= doTune(encoderTune);
           // Current frequency may have changed
           prefsRequestSave(SAVE_CUR_BAND);
           break;
         case CMD_SCAN:
           // Fast tuning in scan mode
-          needRedraw |= doTune(encoderCount, true);
+          needRedraw |= doTune(encoderTune, true);
           prefsRequestSave(SAVE_CUR_BAND);
           break;
       }
 
       // Clear encoder rotation
-      encoderCount = 0;
+      encoderCount = encoderTune = 0;
     }
     // Reset timeouts while push and rotate is active
     elapsedSleep = elapsedCommand = currentTime;
@@ -833,28 +1004,32 @@ void loop()
       {
         case CMD_NONE:
         case CMD_SCAN:
-          // Tuning
-          needRedraw |= doTune(encoderCount);
+          // Tuning, faster when spinning the encoder fast
+          needRedraw |= doTune(encoderTune);
           // Current frequency may have changed
           prefsRequestSave(SAVE_CUR_BAND);
           break;
         case CMD_FREQ:
           // Digit tuning
-          needRedraw |= doDigit(encoderCount);
+          for(int j = abs(encoderCount) ; j > 0 ; --j)
+            needRedraw |= doDigit(encoderCount>0? 1 : -1);
           // Current frequency may have changed
           prefsRequestSave(SAVE_CUR_BAND);
           break;
         case CMD_SEEK:
           // Seek mode
-          needRedraw |= doSeek(encoderCount);
+          needRedraw |= doSeek(encoderCount>0? 1 : -1);
           // Seek can take long time, renew the timestamp
           currentTime = millis();
+          // Detents that stopped the seek are not for the next one
+          encoderFlush();
           // Current frequency may have changed
           prefsRequestSave(SAVE_CUR_BAND);
           break;
         default:
           // Side bar menus / settings
-          needRedraw |= doSideBar(currentCmd, encoderCount);
+          for(int j = abs(encoderCount) ; j > 0 ; --j)
+            needRedraw |= doSideBar(currentCmd, encoderCount>0? 1 : -1);
           // Current settings, etc. may have changed
           prefsRequestSave(SAVE_ALL);
           break;
@@ -864,7 +1039,7 @@ void loop()
       elapsedSleep = elapsedCommand = currentTime;
 
       // Clear encoder rotation
-      encoderCount = 0;
+      encoderCount = encoderTune = 0;
     }
     else if(pb1st.isLongPressed)
     {
@@ -957,14 +1132,15 @@ void loop()
     elapsedSleep = elapsedCommand = currentTime = millis();
   }
 
-  if((currentTime - elapsedRSSI) > MIN_ELAPSED_RSSI_TIME)
+  // Running scan owns the receiver, measuring other frequencies
+  if(!scanRunning() && (currentTime - elapsedRSSI) > MIN_ELAPSED_RSSI_TIME)
   {
     needRedraw |= processRssiSnr();
     elapsedRSSI = currentTime;
   }
 
   // Periodically check received RDS information
-  if((currentTime - lastRDSCheck) > RDS_CHECK_TIME)
+  if(!scanRunning() && (currentTime - lastRDSCheck) > RDS_CHECK_TIME)
   {
     needRedraw |= (currentMode == FM) && (snr >= 12) && checkRds();
     lastRDSCheck = currentTime;
@@ -977,17 +1153,26 @@ void loop()
     lastScheduleCheck = currentTime;
   }
 
-  // Periodically synchronize time via NTP
+  // Periodically synchronize time via NTP, in the network task
   if((currentTime - lastNTPCheck) > NTP_CHECK_TIME)
   {
-    needRedraw |= ntpSyncTime();
+    netRequest(NET_CMD_NTP);
     lastNTPCheck = currentTime;
   }
 
+  // Set clock once the network task gets NTP time
+  needRedraw |= ntpTickTime();
+
+  // Show EiBi download progress from the network task
+  needRedraw |= eibiTickTime();
+
   // Tick preferences time, saving changes when there has
   // been no activity for a while
   prefsTickTime();
 
+  // Tick occupancy time, writing collected samples
+  occupancyTickTime();
+
   // Tick NETWORK time, connecting to WiFi if requested
   netTickTime();
 
@@ -998,6 +1183,12 @@ void loop()
     needRedraw = true;
   }
 
+  // Measure the next point of a running scan
+  needRedraw |= scanTickTime();
+
+  // Sweep monitored bands when it is time to
+  needRedraw |= monitorTickTime();
+
   // Run clock
   needRedraw |= clockTickTime();
 
@@ -1010,6 +1201,9 @@ void loop()
     background_timer = currentTime;
   }
 
+  // Let other tasks see current radio state
+  radioPublishState();
+
   // Redraw screen if necessary
   if(needRedraw) drawScreen();
 
@@ -0,0 +1,182 @@
+//
+// Host benchmark for EiBi schedule queries: lookups per second from the
+// schedule resident in memory, against the file-backed binary search
+// it replaced (one open, seek and read per probe, one close per lookup),
+// and station name search latency
+//
+// Usage: eibi_bench <directory with schedules.bin>
+//
+#include "host.h"
+#include "LittleFS.h"
+#include "Common.h"
+#include "EIBI.h"
+
+#include <vector>
+
+#define EIBI_PATH "/schedules.bin"
+
+#define LOOKUP_COUNT 200000
+#define FILE_LOOKUP_COUNT 20000
+#define FIND_RESULTS 16
+
+// Station name queries, from common words to rare prefixes
+static const char *findQueries[] =
+{
+  "Radio", "R", "Voice", "Romania", "BBC", "Trans World", "Korea", "Hope 3", "E", "Eu", "Nothing"
+};
+
+static bool entryIsNow(const EibiRecord *entry, int now)
+{
+  if(entry->start==EIBI_ANYTIME || entry->end==EIBI_ANYTIME) return(true);
+  if(entry->start <= entry->end) return(now >= entry->start && now <= entry->end);
+  return(now >= entry->start || now <= entry->end);
+}
+
+//
+// Lookup the way it was done before the schedule was kept in memory
+//
+static bool fileLookup(uint16_t freq, uint8_t hour, uint8_t minute, EibiRecord &entry)
+{
+  fs::File file = LittleFS.open(EIBI_PATH, "rb");
+  EibiHeader hdr;
+
+  if(!file || file.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr)) return(false);
+
+  ssize_t left  = 0;
+  ssize_t right = (ssize_t)hdr.count - 1;
+  ssize_t match = -1;
+
+  // Find the first entry with this frequency, reading one entry per probe
+  while(left <= right)
+  {
+    ssize_t mid = (left + right) / 2;
+    if(!file.seek(sizeof(hdr) + mid * sizeof(entry)) ||
+       file.read((uint8_t *)&entry, sizeof(entry)) != sizeof(entry))
+      return(false);
+
+    if(entry.freq < freq) left = mid + 1;
+    else if(entry.freq > freq) right = mid - 1;
+    else { match = mid; right = mid - 1; }
+  }
+
+  if(match < 0 || !file.seek(sizeof(hdr) + match * sizeof(entry))) return(false);
+
+  // Keep reading entries with this frequency
+  int now = hour * 60 + minute;
+  for(ssize_t j = match ; j < (ssize_t)hdr.count ; ++j)
+  {
+    if(file.read((uint8_t *)&entry, sizeof(entry)) != sizeof(entry) || entry.freq != freq) break;
+    if(entryIsNow(&entry, now)) return(true);
+  }
+
+  return(false);
+}
+
+//
+// Get query frequencies: every other one scheduled, the rest random
+//
+static std::vector<uint16_t> queryFrequencies(size_t count)
+{
+  std::vector<uint16_t> freqs;
+  fs::File file = LittleFS.open(EIBI_PATH, "rb");
+  EibiHeader hdr;
+  EibiRecord rec;
+
+  if(!file || file.read((uint8_t *)&hdr, sizeof(hdr)) != sizeof(hdr) || !hdr.count) return(freqs);
+
+  srand(1);
+  for(size_t j = 0 ; j < count ; ++j)
+  {
+    if(j & 1)
+      freqs.push_back(EIBI_BUCKET_MIN + rand() % (EIBI_BUCKET_MAX - EIBI_BUCKET_MIN));
+    else
+    {
+      file.seek(sizeof(hdr) + (rand() % hdr.count) * sizeof(rec));
+      file.read((uint8_t *)&rec, sizeof(rec));
+      freqs.push_back(rec.freq);
+    }
+  }
+
+  return(freqs);
+}
+
+int main(int argc, char *argv[])
+{
+  if(argc != 2)
+  {
+    fprintf(stderr, "Usage: %s <directory with schedules.bin>\n", argv[0]);
+    return(2);
+  }
+
+  hostFsRoot(argv[1]);
+
+  double t = hostTime();
+  eibiInit();
+  t = hostTime() - t;
+
+  if(!eibiAvailable())
+  {
+    fprintf(stderr, "%s" EIBI_PATH ": no valid schedule\n", argv[1]);
+    return(1);
+  }
+
+  printf("Schedule loaded in %.1f ms\n", t * 1000);
+
+  std::vector<uint16_t> freqs = queryFrequencies(LOOKUP_COUNT);
+  size_t found = 0, mismatches = 0;
+
+  // Resident schedule
+  t = hostTime();
+  for(size_t j = 0 ; j < freqs.size() ; ++j)
+    found += !!eibiLookup(freqs[j], (j / 60) % 24, j % 60);
+  t = hostTime() - t;
+  printf("Resident:    %10.0f lookups/s (%zu of %zu found)\n", freqs.size() / t, found, freqs.size());
+
+  // File-backed search, on fewer queries
+  EibiRecord entry;
+  found = 0;
+  t = hostTime();
+  for(size_t j = 0 ; j < FILE_LOOKUP_COUNT ; ++j)
+    found += fileLookup(freqs[j], (j / 60) % 24, j % 60, entry);
+  t = hostTime() - t;
+  printf("File-backed: %10.0f lookups/s (%zu of %d found)\n", FILE_LOOKUP_COUNT / t, found, FILE_LOOKUP_COUNT);
+
+  // Both must give the same answers
+  for(size_t j = 0 ; j < FILE_LOOKUP_COUNT ; ++j)
+  {
+    const StationSchedule *s = eibiLookup(freqs[j], (j / 60) % 24, j % 60);
+    bool f = fileLookup(freqs[j], (j / 60) % 24, j % 60, entry);
+    mismatches += !!s != f || (s && (s->start_h * 60 + s->start_m) != (entry.start==EIBI_ANYTIME? -60 : entry.start));
+  }
+
+  if(mismatches)
+  {
+    printf("FAILED: %zu lookups differ\n", mismatches);
+    return(1);
+  }
+
+  printf("Host file reads come from the page cache, on the radio each one is a LittleFS flash access\n");
+
+  // Station name search, at every hour of the day
+  StationSchedule results[FIND_RESULTS];
+  printf("\n%-12s %8s %10s %10s\n", "Query", "Results", "Mean us", "Worst us");
+
+  for(size_t q = 0 ; q < ITEM_COUNT(findQueries) ; ++q)
+  {
+    double total = 0, worst = 0;
+    size_t count = 0;
+
+    for(int j = 0 ; j < 24 * 60 ; j += 5)
+    {
+      t = hostTime();
+      count += eibiFind(findQueries[q], j / 60, j % 60, results, FIND_RESULTS);
+      t = hostTime() - t;
+      total += t;
+      worst = max(worst, t);
+    }
+
+    printf("%-12s %8.1f %10.1f %10.1f\n", findQueries[q], count / (24 * 12.0), total / (24 * 12) * 1e6, worst * 1e6);
+  }
+
+  return(0);
+}
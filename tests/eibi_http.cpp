@@ -0,0 +1,38 @@
+//
+// Host driver for the EiBi downloader: runs eibiLoadSchedule() against
+// a local HTTP server (see eibi_server.py), printing one line per load:
+//   <ok> <seconds> <status line>
+//
+// Usage: eibi_http <directory for schedules.bin> <url> [loads]
+//
+#include "host.h"
+#include "Common.h"
+#include "EIBI.h"
+
+int main(int argc, char *argv[])
+{
+  if(argc < 3 || argc > 4)
+  {
+    fprintf(stderr, "Usage: %s <directory for schedules.bin> <url> [loads]\n", argv[0]);
+    return(2);
+  }
+
+  hostFsRoot(argv[1]);
+  hostEibiUrl = argv[2];
+  int loads = argc > 3? atoi(argv[3]) : 1;
+
+  eibiInit();
+
+  for(int j = 0 ; j < loads ; ++j)
+  {
+    double t = hostTime();
+    bool ok = eibiLoadSchedule();
+    t = hostTime() - t;
+
+    const char *status = eibiLoadStatus();
+    printf("%d %.3f %s\n", ok, t, status? status : "");
+    fflush(stdout);
+  }
+
+  return(0);
+}
@@ -0,0 +1,128 @@
+#!/usr/bin/env python3
+"""
+Local HTTP stand-in for the EiBi site, serving one eibi.txt with ETag
+and Last-Modified validators, 304 answers to conditional requests and
+optional gzip encoding. Used by test_eibi_http.py, and to benchmark
+the firmware downloader (built for the host as eibi_http).
+
+Usage:
+    eibi_server.py bench eibi.txt build/eibi_http
+"""
+
+import argparse
+import email.utils
+import gzip
+import http.server
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+import zlib
+
+
+class EibiHandler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.0"
+
+    def do_GET(self):
+        server = self.server
+        server.requests.append(dict(self.headers))
+
+        etag = '"%08x"' % zlib.crc32(server.data)
+        modified = email.utils.formatdate(server.mtime, usegmt=True)
+        if self.headers.get("If-None-Match") == etag or self.headers.get("If-Modified-Since") == modified:
+            self.send_response(304)
+            self.end_headers()
+            return
+
+        use_gzip = server.compress and "gzip" in self.headers.get("Accept-Encoding", "")
+        body = server.gzipped if use_gzip else server.data
+
+        self.send_response(200)
+        self.send_header("Content-Type", "text/plain")
+        self.send_header("Content-Length", str(len(body)))
+        if server.validators:
+            self.send_header("ETag", etag)
+            self.send_header("Last-Modified", modified)
+        if use_gzip:
+            self.send_header("Content-Encoding", "gzip")
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, format, *args):
+        pass
+
+
+class EibiServer(http.server.ThreadingHTTPServer):
+    """Serve schedule text on 127.0.0.1, on a free port, from a thread."""
+
+    def __init__(self, data, compress=False, validators=True):
+        super().__init__(("127.0.0.1", 0), EibiHandler)
+        self.mtime = 1700000000
+        self.set_data(data)
+        self.compress = compress
+        self.validators = validators
+        self.requests = []
+        self.thread = threading.Thread(target=self.serve_forever, daemon=True)
+        self.thread.start()
+
+    @property
+    def url(self):
+        return "http://127.0.0.1:%d/eibi.txt" % self.server_address[1]
+
+    def set_data(self, data):
+        self.data = data
+        self.gzipped = gzip.compress(data)
+
+    def update(self, data):
+        """Publish a new schedule."""
+        self.set_data(data)
+        self.mtime += 3600
+
+    def close(self):
+        self.shutdown()
+        self.server_close()
+
+
+def run_loads(driver, url, loads=1, root=None):
+    """Run the host downloader, returning [(ok, seconds, status)] per load."""
+    with tempfile.TemporaryDirectory() as tmp:
+        out = subprocess.run([driver, root or tmp, url, str(loads)], check=True, capture_output=True, text=True).stdout
+    results = []
+    for line in out.splitlines():
+        ok, seconds, status = line.split(" ", 2)
+        results.append((ok == "1", float(seconds), status))
+    return results
+
+
+def bench(text_path, driver):
+    with open(text_path, "rb") as f:
+        data = f.read()
+
+    for use_gzip in (False, True):
+        server = EibiServer(data, compress=use_gzip)
+        try:
+            (ok, seconds, status), = run_loads(driver, server.url)
+        finally:
+            server.close()
+        if not ok:
+            sys.exit("Download failed: %s" % status)
+        sent = len(server.gzipped) if use_gzip else len(data)
+        print("%-5s %8d bytes sent, %.3f s, %6.2f MB/s of schedule text" %
+              ("gzip" if use_gzip else "plain", sent, seconds, len(data) / seconds / 1e6))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("bench", help="time downloads of eibi.txt by the host downloader")
+    p.add_argument("input", help="eibi.txt file to serve")
+    p.add_argument("driver", help="host downloader (eibi_http)")
+
+    args = parser.parse_args()
+    bench(args.input, os.path.abspath(args.driver))
+
+
+if __name__ == "__main__":
+    main()
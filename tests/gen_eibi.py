@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""
+Generate a synthetic, full-size eibi.txt for the host benchmarks: about
+as many entries, stations, languages and targets as the real schedule,
+with the same column layout.
+
+Usage:
+    gen_eibi.py [-n 11000] [-o eibi.txt]
+"""
+
+import argparse
+import random
+
+# Broadcast bands most entries fall into, in kHz
+BANDS = (
+    (153, 279), (531, 1602), (2300, 2495), (3200, 3400), (3900, 4000),
+    (4750, 5060), (5900, 6200), (7200, 7600), (9400, 9900), (11600, 12100),
+    (13570, 13870), (15100, 15800), (17480, 17900), (21450, 21850), (25670, 26100),
+)
+
+PREFIXES = ("Radio", "Voice of", "R.", "Trans World Radio", "BBC", "KBS World Radio",
+            "China Radio Int.", "Adventist World R.", "Radio Free", "Deutsche Welle")
+PLACES = ("Romania International", "Japan", "Korea", "Turkey", "Vietnam", "Nigeria",
+          "Australia", "Havana Cuba", "Thailand", "Mongolia", "Taiwan Int.", "Asia",
+          "Tirana", "Ukraine", "Kuwait", "Marti", "Africa", "Myanmar", "Nepal", "Hope")
+LANGS = ("E", "F", "S", "A", "R", "G", "M", "J", "K", "P", "I", "Ro", "Ru", "-CW", "-TS", "Hin", "Sw")
+TARGETS = ("Eu", "NAm", "SAm", "Af", "ME", "As", "SEA", "FE", "Oc", "CIS", "WEu", "EAf", "SAs")
+DAYS = ("", "", "", "", "1245", "Mo-Fr", "Sa", "Su", "67", "1-5")
+
+
+def station_names(count, rnd):
+    names = set()
+    while len(names) < count:
+        name = "%s %s" % (rnd.choice(PREFIXES), rnd.choice(PLACES))
+        if len(names) >= len(PREFIXES) * len(PLACES) // 2:
+            name += " %d" % rnd.randrange(1000)
+        names.add(name[:24])
+    return sorted(names)
+
+
+def eibi_line(freq, start, end, days, itu, name, lang, target):
+    """Format one entry, times given in minutes."""
+    line = ("%g" % freq).ljust(14)
+    line += ("%02d%02d-%02d%02d" % (divmod(start, 60) + divmod(end, 60))).ljust(9)
+    line += days.ljust(6)
+    line += itu.ljust(5)
+    line += name.ljust(24)
+    line += lang.ljust(5)
+    line += target.ljust(5)
+    return line
+
+
+def generate(count, seed=1):
+    rnd = random.Random(seed)
+    names = station_names(max(count // 7, 1), rnd)
+    lines = ["kHz:75 Time(UTC):93 Days:59 ITU:49 Station:201 Lng:49 Target:62 Remarks:135 P:35 Start:60 Stop:60", ""]
+    for _ in range(count):
+        lo, hi = rnd.choice(BANDS)
+        freq = rnd.randrange(lo, hi + 1, 5 if lo > 1700 else 9)
+        start = rnd.randrange(48) * 30
+        end = (start + rnd.choice((30, 60, 60, 120, 180))) % 1440
+        lines.append(eibi_line(freq, start, end, rnd.choice(DAYS), "ROU",
+                               rnd.choice(names), rnd.choice(LANGS), rnd.choice(TARGETS)))
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-n", "--count", type=int, default=11000, help="number of entries")
+    parser.add_argument("-o", "--output", default="eibi.txt", help="output file")
+    args = parser.parse_args()
+
+    with open(args.output, "w", encoding="latin-1") as f:
+        f.write(generate(args.count))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,106 @@
+//
+// Minimal host replacement for the Arduino core, enough to build the
+// firmware's schedule, scan and peak code under g++ (see host.cpp)
+//
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+#include <algorithm>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define ICACHE_RAM_ATTR
+#define HIGH 1
+#define LOW  0
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void yield();
+int digitalRead(int pin);
+
+// PSRAM allocations come from the regular heap
+void *ps_malloc(size_t size);
+void *ps_calloc(size_t n, size_t size);
+void *ps_realloc(void *ptr, size_t size);
+
+class String
+{
+  public:
+    String(const char *s = "") : s_(s? s : "") {}
+    String(const std::string &s) : s_(s) {}
+    String(int v) : s_(std::to_string(v)) {}
+
+    const char *c_str() const { return(s_.c_str()); }
+    unsigned int length() const { return(s_.size()); }
+    bool isEmpty() const { return(s_.empty()); }
+    long toInt() const { return(atol(s_.c_str())); }
+
+    bool operator==(const char *s) const { return(s_ == s); }
+    bool operator==(const String &s) const { return(s_ == s.s_); }
+    bool operator!=(const char *s) const { return(s_ != s); }
+    String operator+(const String &s) const { return(String(s_ + s.s_)); }
+    String &operator+=(const String &s) { s_ += s.s_; return(*this); }
+    friend String operator+(const char *a, const String &b) { return(String(std::string(a) + b.s_)); }
+
+  private:
+    std::string s_;
+};
+
+class Stream
+{
+  public:
+    virtual ~Stream() {}
+    virtual int available() { return(0); }
+    virtual int read() { return(-1); }
+    virtual int peek() { return(-1); }
+    virtual size_t write(uint8_t c) { return(write(&c, 1)); }
+    virtual size_t write(const uint8_t *buf, size_t size) { return(0); }
+
+    size_t readBytes(uint8_t *buf, size_t size)
+    {
+      size_t n = 0;
+      for(int c ; n < size && (c = read()) >= 0 ; ) buf[n++] = c;
+      return(n);
+    }
+
+    size_t readBytes(char *buf, size_t size) { return(readBytes((uint8_t *)buf, size)); }
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)))
+    {
+      char buf[256];
+      va_list args;
+      va_start(args, format);
+      int n = vsnprintf(buf, sizeof(buf), format, args);
+      va_end(args);
+      return(write((const uint8_t *)buf, n < (int)sizeof(buf)? n : sizeof(buf) - 1));
+    }
+
+    size_t print(const char *s) { return(write((const uint8_t *)s, strlen(s))); }
+    size_t println(const char *s = "") { return(print(s) + print("\r\n")); }
+};
+
+// Serial output goes to stdout
+class HostSerial : public Stream
+{
+  public:
+    using Stream::write;
+    size_t write(const uint8_t *buf, size_t size) override { return(fwrite(buf, 1, size, stdout)); }
+    void flush() { fflush(stdout); }
+};
+
+extern HostSerial Serial;
+
+#endif // HOST_ARDUINO_H
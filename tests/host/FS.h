@@ -0,0 +1,64 @@
+//
+// Host file system: paths are mapped under a directory set with
+// hostFsRoot(), files are shared between copies like on the device
+//
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include "Arduino.h"
+#include <memory>
+
+namespace fs
+{
+
+enum SeekMode { SeekSet = SEEK_SET, SeekCur = SEEK_CUR, SeekEnd = SEEK_END };
+
+class File : public Stream
+{
+  public:
+    File() {}
+    File(FILE *f) : f_(f, fclose) {}
+
+    operator bool() const { return(!!f_); }
+
+    size_t size()
+    {
+      long pos = ftell(f_.get());
+      fseek(f_.get(), 0, SEEK_END);
+      long size = ftell(f_.get());
+      fseek(f_.get(), pos, SEEK_SET);
+      return(size);
+    }
+
+    size_t position() { return(ftell(f_.get())); }
+    bool seek(size_t pos, SeekMode mode = SeekSet) { return(!fseek(f_.get(), pos, mode)); }
+    int available() override { return(size() - position()); }
+    size_t read(uint8_t *buf, size_t size) { return(fread(buf, 1, size, f_.get())); }
+    int read() override { return(fgetc(f_.get())); }
+
+    using Stream::write;
+    size_t write(const uint8_t *buf, size_t size) override { return(fwrite(buf, 1, size, f_.get())); }
+
+    time_t getLastWrite();
+    void flush() { fflush(f_.get()); }
+    void close() { f_.reset(); }
+
+  private:
+    std::shared_ptr<FILE> f_;
+};
+
+class FS
+{
+  public:
+    File open(const char *path, const char *mode = "r", bool create = false);
+    bool exists(const char *path);
+    bool remove(const char *path);
+    bool rename(const char *from, const char *to);
+};
+
+}
+
+// Set host directory holding the device files
+void hostFsRoot(const char *dir);
+
+#endif // HOST_FS_H
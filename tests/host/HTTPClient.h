@@ -0,0 +1,40 @@
+//
+// Host HTTP/1.0 client, with the subset of the ESP32 HTTPClient API
+// used by the firmware
+//
+#ifndef HOST_HTTPCLIENT_H
+#define HOST_HTTPCLIENT_H
+
+#include "WiFi.h"
+#include <map>
+#include <vector>
+
+#define HTTP_CODE_OK           200
+#define HTTP_CODE_NOT_MODIFIED 304
+
+class HTTPClient
+{
+  public:
+    bool begin(const char *url);
+    void useHTTP10(bool on = true) {}
+    void collectHeaders(const char *keys[], size_t count);
+    void addHeader(const String &name, const String &value);
+    int GET();
+    void end() { client_.stop(); }
+
+    bool connected() { return(client_.connected() || client_.available()); }
+    WiFiClient *getStreamPtr() { return(&client_); }
+    int getSize() { return(size_); }
+    String header(const char *name);
+
+  private:
+    WiFiClient client_;
+    std::string host_, path_;
+    uint16_t port_ = 80;
+    std::string request_;
+    std::vector<std::string> keys_;
+    std::map<std::string, std::string> headers_;
+    int size_ = -1;
+};
+
+#endif // HOST_HTTPCLIENT_H
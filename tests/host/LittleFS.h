@@ -0,0 +1,14 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "FS.h"
+
+class LittleFSFS : public fs::FS
+{
+  public:
+    bool begin(bool formatOnFail = false) { return(true); }
+};
+
+extern LittleFSFS LittleFS;
+
+#endif // HOST_LITTLEFS_H
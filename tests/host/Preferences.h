@@ -0,0 +1,27 @@
+//
+// Host preferences, kept in memory and shared by all instances,
+// like the NVS storage behind them
+//
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include "Arduino.h"
+#include <map>
+
+class Preferences
+{
+  public:
+    bool begin(const char *name, bool readOnly = false, const char *partition = NULL) { ns_ = name; return(true); }
+    void end() {}
+
+    size_t putString(const char *key, const String &value) { values_[ns_ + "/" + key] = value.c_str(); return(value.length()); }
+    String getString(const char *key, const String &def = String());
+    size_t getString(const char *key, char *value, size_t size);
+    bool remove(const char *key) { return(values_.erase(ns_ + "/" + key) > 0); }
+
+  private:
+    std::string ns_;
+    static std::map<std::string, std::string> values_;
+};
+
+#endif // HOST_PREFERENCES_H
@@ -0,0 +1,37 @@
+//
+// Host builds do not talk to the radio, the receiver is only declared
+//
+#ifndef HOST_SI4735_H
+#define HOST_SI4735_H
+
+#include "Arduino.h"
+
+#define SSB_CURRENT_MODE 2
+
+typedef union
+{
+  struct { uint8_t FREQL, FREQH; } raw;
+  uint16_t value;
+} si47x_frequency;
+
+class SI4735
+{
+  public:
+    struct { struct { uint8_t BLOCKAH, BLOCKAL, BLOCKBH, BLOCKBL; } resp; } currentRdsStatus;
+    struct { struct { uint8_t READFREQH, READFREQL, VALID, BLTF; } resp; } currentStatus;
+    uint8_t lastMode = 0;
+    uint16_t maxDelaySetFrequency = 0;
+    uint32_t maxSeekTime = 0;
+    uint16_t currentWorkFrequency = 0;
+
+    void seekStation(uint8_t up, uint8_t wrap) {}
+    void getStatus(uint8_t intack, uint8_t cancel) {}
+
+    bool getRdsReceived() { return(false); }
+    bool getRdsNewBlockA() { return(false); }
+    uint8_t getRdsVersionCode() { return(0); }
+    char *getRdsText2A() { return(NULL); }
+    char *getRdsText2B() { return(NULL); }
+};
+
+#endif // HOST_SI4735_H
@@ -0,0 +1,17 @@
+//
+// Host builds do not draw, the display is only declared
+//
+#ifndef HOST_TFT_ESPI_H
+#define HOST_TFT_ESPI_H
+
+#include "Arduino.h"
+
+class TFT_eSPI {};
+
+class TFT_eSprite : public TFT_eSPI
+{
+  public:
+    TFT_eSprite(TFT_eSPI *tft) {}
+};
+
+#endif // HOST_TFT_ESPI_H
@@ -0,0 +1,29 @@
+//
+// Host network client: a blocking TCP socket
+//
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include "Arduino.h"
+
+class WiFiClient : public Stream
+{
+  public:
+    ~WiFiClient() { stop(); }
+
+    bool connect(const char *host, uint16_t port);
+    bool connected();
+    void stop();
+
+    int available() override;
+    int read() override;
+    int read(uint8_t *buf, size_t size);
+
+    using Stream::write;
+    size_t write(const uint8_t *buf, size_t size) override;
+
+  private:
+    int fd_ = -1;
+};
+
+#endif // HOST_WIFI_H
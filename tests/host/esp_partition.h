@@ -0,0 +1,34 @@
+//
+// Host builds have no raw flash partitions, schedules go to files
+//
+#ifndef HOST_ESP_PARTITION_H
+#define HOST_ESP_PARTITION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+#define ESP_OK   0
+#define ESP_FAIL (-1)
+
+typedef enum { ESP_PARTITION_TYPE_APP, ESP_PARTITION_TYPE_DATA } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xFF } esp_partition_subtype_t;
+typedef enum { ESP_PARTITION_MMAP_DATA, ESP_PARTITION_MMAP_INST } esp_partition_mmap_memory_t;
+typedef uint32_t esp_partition_mmap_handle_t;
+
+typedef struct
+{
+  uint32_t address;
+  uint32_t size;
+  uint32_t erase_size;
+  char label[17];
+} esp_partition_t;
+
+static inline const esp_partition_t *esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t, const char *) { return(NULL); }
+static inline esp_err_t esp_partition_read(const esp_partition_t *, size_t, void *, size_t) { return(ESP_FAIL); }
+static inline esp_err_t esp_partition_write(const esp_partition_t *, size_t, const void *, size_t) { return(ESP_FAIL); }
+static inline esp_err_t esp_partition_erase_range(const esp_partition_t *, size_t, size_t) { return(ESP_FAIL); }
+static inline esp_err_t esp_partition_mmap(const esp_partition_t *, size_t, size_t, esp_partition_mmap_memory_t, const void **, esp_partition_mmap_handle_t *) { return(ESP_FAIL); }
+static inline void esp_partition_munmap(esp_partition_mmap_handle_t) {}
+
+#endif // HOST_ESP_PARTITION_H
@@ -0,0 +1,13 @@
+#ifndef HOST_ESP_ROM_CRC_H
+#define HOST_ESP_ROM_CRC_H
+
+#include <stdint.h>
+#include <zlib.h>
+
+// Same CRC32 as zlib's
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len)
+{
+  return(crc32(crc, buf, len));
+}
+
+#endif // HOST_ESP_ROM_CRC_H
@@ -0,0 +1,272 @@
+//
+// Host implementations of the Arduino, ESP32 and firmware functions
+// that the code under test calls
+//
+#include "host.h"
+#include "LittleFS.h"
+#include "Preferences.h"
+#include "HTTPClient.h"
+#include "rom/miniz.h"
+
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <time.h>
+#include <zlib.h>
+#include <map>
+
+std::string hostStatus;
+int hostWeekday = -1;
+const char *hostEibiUrl = "http://127.0.0.1:8000/eibi.txt";
+
+HostSerial Serial;
+LittleFSFS LittleFS;
+Preferences prefs;
+
+// Firmware state the schedule code looks at
+uint16_t currentFrequency = 0;
+int16_t currentBFO = 0;
+
+double hostTime()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return(ts.tv_sec + ts.tv_nsec / 1e9);
+}
+
+uint32_t millis() { return((uint32_t)(hostTime() * 1000)); }
+uint32_t micros() { return((uint32_t)(hostTime() * 1000000)); }
+void delay(uint32_t ms) { usleep(ms * 1000); }
+void yield() {}
+int digitalRead(int pin) { return(HIGH); }
+
+void *ps_malloc(size_t size) { return(malloc(size)); }
+void *ps_calloc(size_t n, size_t size) { return(calloc(n, size)); }
+void *ps_realloc(void *ptr, size_t size) { return(realloc(ptr, size)); }
+
+//
+// Firmware functions outside of the code under test
+//
+void drawScreen(const char *statusLine1, const char *statusLine2)
+{
+  hostStatus = statusLine2? statusLine2 : statusLine1? statusLine1 : "";
+}
+
+int clockGetWeekday() { return(hostWeekday); }
+int8_t getWiFiStatus() { return(2); }
+bool identifyFrequency(uint16_t freq, bool periodic) { return(false); }
+bool netRequest(uint8_t cmd) { return(false); }
+
+//
+// File system
+//
+static std::string fsRoot = ".";
+
+void hostFsRoot(const char *dir) { fsRoot = dir; }
+
+static std::string fsPath(const char *path) { return(fsRoot + path); }
+
+fs::File fs::FS::open(const char *path, const char *mode, bool create)
+{
+  FILE *f = fopen(fsPath(path).c_str(), mode);
+  return(f? File(f) : File());
+}
+
+bool fs::FS::exists(const char *path) { return(!access(fsPath(path).c_str(), F_OK)); }
+bool fs::FS::remove(const char *path) { return(!::remove(fsPath(path).c_str())); }
+bool fs::FS::rename(const char *from, const char *to) { return(!::rename(fsPath(from).c_str(), fsPath(to).c_str())); }
+
+time_t fs::File::getLastWrite()
+{
+  struct stat st;
+  fflush(f_.get());
+  return(fstat(fileno(f_.get()), &st)? 0 : st.st_mtime);
+}
+
+//
+// Preferences
+//
+std::map<std::string, std::string> Preferences::values_;
+
+String Preferences::getString(const char *key, const String &def)
+{
+  auto j = values_.find(ns_ + "/" + key);
+  return(j == values_.end()? def : String(j->second));
+}
+
+size_t Preferences::getString(const char *key, char *value, size_t size)
+{
+  auto j = values_.find(ns_ + "/" + key);
+  if(j == values_.end() || !size) return(0);
+  snprintf(value, size, "%s", j->second.c_str());
+  return(strlen(value) + 1);
+}
+
+//
+// Network
+//
+bool WiFiClient::connect(const char *host, uint16_t port)
+{
+  struct addrinfo hints = {}, *res;
+  char service[8];
+
+  stop();
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  snprintf(service, sizeof(service), "%u", port);
+  if(getaddrinfo(host, service, &hints, &res)) return(false);
+
+  fd_ = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  if(fd_ >= 0 && ::connect(fd_, res->ai_addr, res->ai_addrlen)) stop();
+  freeaddrinfo(res);
+  return(fd_ >= 0);
+}
+
+void WiFiClient::stop()
+{
+  if(fd_ >= 0) close(fd_);
+  fd_ = -1;
+}
+
+bool WiFiClient::connected()
+{
+  if(fd_ < 0) return(false);
+
+  // Connected until the peer closes and all data is read
+  struct pollfd p = { fd_, POLLIN, 0 };
+  char c;
+  return(poll(&p, 1, 0) <= 0 || recv(fd_, &c, 1, MSG_PEEK) > 0);
+}
+
+int WiFiClient::available()
+{
+  int n = 0;
+  return(fd_ >= 0 && !ioctl(fd_, FIONREAD, &n)? n : 0);
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size)
+{
+  return(fd_ >= 0? recv(fd_, buf, size, 0) : -1);
+}
+
+int WiFiClient::read()
+{
+  uint8_t c;
+  return(read(&c, 1) == 1? c : -1);
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size)
+{
+  return(fd_ >= 0? send(fd_, buf, size, MSG_NOSIGNAL) : 0);
+}
+
+bool HTTPClient::begin(const char *url)
+{
+  // Only plain "http://host[:port]/path" URLs
+  const char *p = strncmp(url, "http://", 7)? NULL : url + 7;
+  if(!p) return(false);
+
+  const char *path = strchr(p, '/');
+  host_ = path? std::string(p, path - p) : p;
+  path_ = path? path : "/";
+
+  size_t colon = host_.find(':');
+  port_ = colon == std::string::npos? 80 : atoi(host_.c_str() + colon + 1);
+  if(colon != std::string::npos) host_.resize(colon);
+
+  request_.clear();
+  headers_.clear();
+  size_ = -1;
+  return(true);
+}
+
+void HTTPClient::collectHeaders(const char *keys[], size_t count)
+{
+  keys_.assign(keys, keys + count);
+}
+
+void HTTPClient::addHeader(const String &name, const String &value)
+{
+  request_ += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+}
+
+String HTTPClient::header(const char *name)
+{
+  auto j = headers_.find(name);
+  return(j == headers_.end()? String() : String(j->second));
+}
+
+int HTTPClient::GET()
+{
+  if(!client_.connect(host_.c_str(), port_)) return(-1);
+
+  std::string req = "GET " + path_ + " HTTP/1.0\r\nHost: " + host_ + "\r\n" + request_ + "\r\n";
+  client_.write((const uint8_t *)req.data(), req.size());
+
+  // Read status line and headers, byte by byte, leaving the body
+  std::string line;
+  int code = -1;
+  for(int c ; (c = client_.read()) >= 0 ; )
+  {
+    if(c != '\n') { if(c != '\r') line += c; continue; }
+    if(line.empty()) return(code);
+
+    if(code < 0)
+      code = sscanf(line.c_str(), "HTTP/%*s %d", &code) == 1? code : 0;
+    else
+    {
+      size_t colon = line.find(':');
+      std::string key = line.substr(0, colon);
+      std::string value = colon == std::string::npos? "" : line.substr(line.find_first_not_of(' ', colon + 1));
+
+      if(!strcasecmp(key.c_str(), "Content-Length")) size_ = atoi(value.c_str());
+      for(auto &k : keys_)
+        if(!strcasecmp(k.c_str(), key.c_str())) headers_[k] = value;
+    }
+
+    line.clear();
+  }
+
+  return(-1);
+}
+
+//
+// Inflater: zlib streams kept by decompressor address
+//
+static std::map<tinfl_decompressor *, z_stream *> inflaters;
+
+void hostTinflInit(tinfl_decompressor *r)
+{
+  z_stream *&z = inflaters[r];
+  if(z) inflateEnd(z); else z = new z_stream;
+
+  memset(z, 0, sizeof(*z));
+  inflateInit2(z, -MAX_WBITS);
+}
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r,
+  const uint8_t *pIn_buf_next, size_t *pIn_buf_size,
+  uint8_t *pOut_buf_start, uint8_t *pOut_buf_next, size_t *pOut_buf_size,
+  const uint32_t decomp_flags)
+{
+  z_stream *z = inflaters[r];
+  if(!z) return(TINFL_STATUS_BAD_PARAM);
+
+  z->next_in   = (Bytef *)pIn_buf_next;
+  z->avail_in  = *pIn_buf_size;
+  z->next_out  = pOut_buf_next;
+  z->avail_out = *pOut_buf_size;
+
+  int status = inflate(z, Z_NO_FLUSH);
+  *pIn_buf_size -= z->avail_in;
+  *pOut_buf_size -= z->avail_out;
+
+  if(status == Z_STREAM_END) return(TINFL_STATUS_DONE);
+  if(status != Z_OK && status != Z_BUF_ERROR) return(TINFL_STATUS_FAILED);
+  if(!z->avail_out) return(TINFL_STATUS_HAS_MORE_OUTPUT);
+  if(!(decomp_flags & TINFL_FLAG_HAS_MORE_INPUT) && !z->avail_in) return(TINFL_STATUS_FAILED);
+  return(TINFL_STATUS_NEEDS_MORE_INPUT);
+}
@@ -0,0 +1,22 @@
+//
+// Host test harness: firmware globals and hooks the tests control
+//
+#ifndef HOST_H
+#define HOST_H
+
+#include "Arduino.h"
+#include "FS.h"
+
+// Last status line shown with drawScreen()
+extern std::string hostStatus;
+
+// Weekday (0 = Monday) returned by clockGetWeekday(), -1 if unknown
+extern int hostWeekday;
+
+// URL used by eibiLoadSchedule(), see EIBI_URL in the Makefile
+extern const char *hostEibiUrl;
+
+// Time in seconds, with microsecond resolution
+double hostTime();
+
+#endif // HOST_H
@@ -0,0 +1,133 @@
+//
+// Host tests for the band occupancy database (ats-mini/Occupancy.cpp)
+//
+// Usage: occupancy_test
+//
+#include "host.h"
+#include "Common.h"
+#include "Utils.h"
+#include "Occupancy.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { if(!(cond)) { printf("%s:%d: FAILED: %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+// Clock the database sees, day < 0 when not set
+static int32_t today = -1;
+static uint8_t hour = 12;
+
+uint8_t currentMode = 1;
+
+bool clockGetHM(uint8_t *hours, uint8_t *minutes)
+{
+  if(today < 0) return(false);
+  *hours = hour;
+  *minutes = 0;
+  return(true);
+}
+
+int32_t clockGetDay() { return(today); }
+
+// Add samples without a signal
+static void addQuiet(uint16_t freq, int count)
+{
+  for(int j = 0 ; j < count ; ++j) occupancyAdd(freq, 10, 0);
+}
+
+// Count channels reported dead out of repeated checks, every
+// OCC_RECHECK_EVERY one (8) is reported alive
+static int deadCount(uint16_t freq)
+{
+  int n = 0;
+  for(int j = 0 ; j < 8 ; ++j) n += occupancyDead(freq);
+  return(n);
+}
+
+static void testDeadNeedsDays()
+{
+  // Many samples in a short time are not enough
+  today = 20000;
+  addQuiet(7100, 40);
+  CHECK(occupancyGet(7100) && occupancyGet(7100)->firstDay == 20000);
+  CHECK(deadCount(7100) == 0);
+
+  today = 20013;
+  CHECK(deadCount(7100) == 0);
+  today = 20014;
+  CHECK(deadCount(7100) == 7);
+
+  // Other hours of day have their own cells
+  hour = 13;
+  CHECK(deadCount(7100) == 0);
+  hour = 12;
+}
+
+static void testSignalKeepsAlive()
+{
+  today = 20100;
+  addQuiet(7200, 20);
+  today = 20110;
+  occupancyAdd(7200, 40, 20);
+
+  today = 20120;
+  CHECK(deadCount(7200) == 0);
+  today = 20124;
+  CHECK(deadCount(7200) == 7);
+}
+
+static void testNoClock()
+{
+  today = -1;
+  addQuiet(7300, 40);
+  CHECK(occupancyGet(7300) && occupancyGet(7300)->firstDay == 0);
+  CHECK(deadCount(7300) == 0);
+}
+
+static void testEviction()
+{
+  today = 20200;
+
+  // Well established channels
+  for(uint16_t freq = 9400 ; freq < 9500 ; freq += 5) addQuiet(freq, 20);
+
+  // Sweep of many more channels than the table holds
+  int added = 0;
+  for(hour = 0 ; hour < 24 ; ++hour)
+    for(uint16_t freq = 10000 ; freq < 14000 ; ++freq, ++added)
+      occupancyAdd(freq, 10, 0);
+  hour = 23;
+
+  CHECK(added > (1 << 16));
+
+  // New cells still go in, established ones stay
+  CHECK(occupancyGet(13999) != NULL);
+  hour = 12;
+  for(uint16_t freq = 9400 ; freq < 9500 ; freq += 5)
+    CHECK(occupancyGet(freq) && occupancyGet(freq)->count == 20);
+  CHECK(occupancyGet(7100) && occupancyGet(7100)->count == 40);
+}
+
+int main(int argc, char *argv[])
+{
+  char dir[] = "/tmp/occupancy_test.XXXXXX";
+  if(!mkdtemp(dir)) return(2);
+  hostFsRoot(dir);
+
+  occupancyInit();
+
+  testDeadNeedsDays();
+  testSignalKeepsAlive();
+  testNoClock();
+  testEviction();
+
+  char cmd[64];
+  snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+  if(system(cmd)) {}
+
+  printf("%s\n", failures? "FAILED" : "OK");
+  return(failures? 1 : 0);
+}
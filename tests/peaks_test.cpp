@@ -0,0 +1,200 @@
+//
+// Host tests for findPeaks() (ats-mini/Peaks.cpp)
+//
+// Usage: peaks_test [data directory]
+//
+#include "Peaks.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+  do { if(!(cond)) { printf("%s:%d: FAILED: %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+#define ITEM_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+//
+// Make scan points at consecutive frequencies from RSSI values,
+// with a good SNR everywhere
+//
+static std::vector<ScanPoint> makePoints(std::initializer_list<int> rssi, uint8_t snr = 20)
+{
+  std::vector<ScanPoint> points;
+  uint16_t freq = 1000;
+  for(int r : rssi) points.push_back({ freq++, (uint8_t)r, snr });
+  return(points);
+}
+
+static int find(const std::vector<ScanPoint> &points, ScanPeak *peaks, int maxPeaks, uint8_t minProminence = 1, uint8_t minSNR = 0)
+{
+  return(findPeaks(points.data(), points.size(), peaks, maxPeaks, minProminence, minSNR));
+}
+
+static void testEmpty()
+{
+  ScanPeak peaks[4];
+  CHECK(find({}, peaks, 4) == 0);
+  CHECK(find(makePoints({ 20 }), peaks, 4) == 0);
+  CHECK(find(makePoints({ 20, 20, 20 }), peaks, 4) == 0);
+  CHECK(find(makePoints({ 10, 30, 10 }), peaks, 0) == 0);
+}
+
+static void testFlatTops()
+{
+  ScanPeak peaks[4];
+
+  // Odd width: middle point
+  CHECK(find(makePoints({ 10, 20, 30, 30, 30, 20, 10 }), peaks, 4) == 1);
+  CHECK(peaks[0].freq == 1003 && peaks[0].rssi == 30 && peaks[0].prominence == 20);
+
+  // Even width: lower of the two middle points
+  CHECK(find(makePoints({ 10, 30, 30, 10 }), peaks, 4) == 1);
+  CHECK(peaks[0].freq == 1001);
+
+  // A shelf on the way up is not a peak
+  CHECK(find(makePoints({ 10, 20, 20, 30, 10 }), peaks, 4) == 1);
+  CHECK(peaks[0].freq == 1003 && peaks[0].prominence == 20);
+}
+
+static void testEdges()
+{
+  ScanPeak peaks[4];
+
+  // Peaks at either edge are measured against their only side
+  CHECK(find(makePoints({ 40, 30, 20, 25, 10 }), peaks, 4) == 2);
+  CHECK(peaks[0].freq == 1000 && peaks[0].prominence == 30);
+  CHECK(peaks[1].freq == 1003 && peaks[1].prominence == 5);
+
+  CHECK(find(makePoints({ 10, 20, 30 }), peaks, 4) == 1);
+  CHECK(peaks[0].freq == 1002 && peaks[0].prominence == 20);
+
+  // Flat top reaching the edge
+  CHECK(find(makePoints({ 10, 30, 30 }), peaks, 4) == 1);
+  CHECK(peaks[0].freq == 1001 && peaks[0].prominence == 20);
+}
+
+static void testProminence()
+{
+  ScanPeak peaks[4];
+
+  // Small peak on the shoulder of a big one: its base is the dip
+  // between them, not the noise floor
+  std::vector<ScanPoint> points = makePoints({ 10, 50, 20, 26, 10 });
+  CHECK(find(points, peaks, 4) == 2);
+  CHECK(peaks[0].freq == 1001 && peaks[0].prominence == 40);
+  CHECK(peaks[1].freq == 1003 && peaks[1].prominence == 6);
+
+  // Threshold is inclusive
+  CHECK(find(points, peaks, 4, 6) == 2);
+  CHECK(find(points, peaks, 4, 7) == 1);
+  CHECK(peaks[0].freq == 1001);
+
+  // Base is the higher of the two sides
+  CHECK(find(makePoints({ 10, 30, 40, 30, 25, 35, 5 }), peaks, 4) == 2);
+  CHECK(peaks[0].freq == 1002 && peaks[0].prominence == 30);
+  CHECK(peaks[1].freq == 1005 && peaks[1].prominence == 10);
+}
+
+static void testSNR()
+{
+  ScanPeak peaks[4];
+  std::vector<ScanPoint> points = makePoints({ 10, 30, 10, 20, 10 });
+  points[3].snr = 5;
+
+  CHECK(find(points, peaks, 4, 1, 5) == 2);
+  CHECK(find(points, peaks, 4, 1, 6) == 1);
+  CHECK(peaks[0].freq == 1001);
+}
+
+static void testTruncation()
+{
+  ScanPeak peaks[8];
+
+  // Prominences 5, 25, 15, 35, 20 in frequency order
+  std::vector<ScanPoint> points = makePoints({ 0, 5, 0, 25, 0, 15, 0, 35, 0, 20, 0 });
+
+  CHECK(find(points, peaks, 8) == 5);
+  CHECK(peaks[0].freq == 1007 && peaks[1].freq == 1003 && peaks[2].freq == 1009);
+  CHECK(peaks[3].freq == 1005 && peaks[4].freq == 1001);
+
+  // Only the strongest ones are kept, in the same order, whatever
+  // order they were found in
+  memset(peaks, 0xFF, sizeof(peaks));
+  CHECK(find(points, peaks, 3) == 3);
+  CHECK(peaks[0].freq == 1007 && peaks[1].freq == 1003 && peaks[2].freq == 1009);
+  CHECK(peaks[3].freq == 0xFFFF);
+
+  CHECK(find(points, peaks, 1) == 1);
+  CHECK(peaks[0].freq == 1007);
+}
+
+static void testTies()
+{
+  ScanPeak peaks[4];
+
+  // Same prominence: stronger first, then lower frequency
+  CHECK(find(makePoints({ 10, 30, 10, 0, 20, 0, 20, 0 }), peaks, 4) == 3);
+  CHECK(peaks[0].freq == 1001 && peaks[0].prominence == 20);
+  CHECK(peaks[1].freq == 1004 && peaks[1].prominence == 20);
+  CHECK(peaks[2].freq == 1006 && peaks[2].prominence == 20);
+}
+
+//
+// 31m band sweep (data/sweep-31m.csv), with the thresholds Scan.cpp uses
+//
+static void testSweep(const char *dir)
+{
+  char path[256];
+  snprintf(path, sizeof(path), "%s/sweep-31m.csv", dir);
+
+  FILE *f = fopen(path, "r");
+  CHECK(f != NULL);
+  if(!f) return;
+
+  std::vector<ScanPoint> points;
+  char line[64];
+  unsigned freq, rssi, snr;
+  while(fgets(line, sizeof(line), f))
+    if(sscanf(line, "%u,%u,%u", &freq, &rssi, &snr) == 3)
+      points.push_back({ (uint16_t)freq, (uint8_t)rssi, (uint8_t)snr });
+  fclose(f);
+
+  CHECK(points.size() == 101);
+
+  // 9760 kHz rises high enough but has no SNR, the rest is noise
+  static const struct { uint16_t freq; uint8_t prominence; } expected[] =
+  {
+    { 9650, 36 }, { 9420, 29 }, { 9535, 21 }, { 9900, 19 }, { 9875, 16 }, { 9580, 9 }
+  };
+
+  ScanPeak peaks[16];
+  int n = find(points, peaks, ITEM_COUNT(peaks), 6, 6);
+  CHECK(n == (int)ITEM_COUNT(expected));
+
+  for(int j = 0 ; j < n && j < (int)ITEM_COUNT(expected) ; ++j)
+  {
+    if(peaks[j].freq != expected[j].freq || peaks[j].prominence != expected[j].prominence)
+      printf("Peak %d: got %u kHz (%u dB), expected %u kHz (%u dB)\n", j,
+        peaks[j].freq, peaks[j].prominence, expected[j].freq, expected[j].prominence);
+    CHECK(peaks[j].freq == expected[j].freq && peaks[j].prominence == expected[j].prominence);
+    CHECK(peaks[j].name == NULL);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  testEmpty();
+  testFlatTops();
+  testEdges();
+  testProminence();
+  testSNR();
+  testTruncation();
+  testTies();
+  testSweep(argc > 1? argv[1] : "data");
+
+  printf("%s\n", failures? "FAILED" : "OK");
+  return(failures? 1 : 0);
+}
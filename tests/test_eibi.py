@@ -0,0 +1,167 @@
+"""
+Host tests for tools/eibi.py, the schedule compiler and merger.
+
+Run with:
+    python3 -m unittest discover -s tests
+"""
+
+import io
+import os
+import struct
+import sys
+import tempfile
+import unittest
+import zlib
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "tools"))
+import eibi  # noqa: E402
+
+DATA = os.path.join(os.path.dirname(os.path.abspath(__file__)), "data")
+
+
+def read_data(name):
+    with open(os.path.join(DATA, name), "rb") as f:
+        return f.read()
+
+
+def eibi_line(freq, time, name, days="", itu="", lang="", target=""):
+    """Format one schedule line in the fixed eibi.txt columns."""
+    line = str(freq).ljust(eibi.COL_TIME)
+    line += time.ljust(eibi.COL_DAYS - eibi.COL_TIME)
+    line += days.ljust(eibi.COL_ITU - eibi.COL_DAYS)
+    line += itu.ljust(eibi.COL_NAME - eibi.COL_ITU)
+    line += name.ljust(eibi.LEN_NAME)
+    line += lang.ljust(eibi.LEN_LANG)
+    line += target
+    return line.encode("latin-1")
+
+
+def image_layout(image):
+    """Get (count, nameCount, namesSize, wordCount, crc) from an image header."""
+    fields = eibi.HEADER.unpack_from(image)
+    return fields[3], fields[4], fields[5], fields[6], fields[8]
+
+
+class ImageLayoutTest(unittest.TestCase):
+    def compile(self, count):
+        lines = [eibi_line(5900 + 5 * j, "0000-0100", "Station %d" % j, lang="E", target="Eu") for j in range(count)]
+        return eibi.compile_schedule(b"\n".join(lines))
+
+    def test_tables_aligned(self):
+        for count in (1, 2, 3, 4, 7):
+            image = self.compile(count)
+            records, name_count, names_size, word_count, crc = image_layout(image)
+            self.assertEqual(records, count)
+
+            # Frequency directory and name tables are read as uint32_t
+            buckets = eibi.HEADER.size + eibi.records_size(count)
+            self.assertEqual(buckets % 4, 0, "%d records" % count)
+            self.assertEqual(len(image), buckets + (eibi.EIBI_BUCKETS + 1 + name_count + word_count) * 4 + names_size)
+
+            # Padding is zeroed and covered by the checksum
+            self.assertEqual(image[eibi.HEADER.size + count * eibi.RECORD.size : buckets], b"\0" * (buckets - eibi.HEADER.size - count * eibi.RECORD.size))
+            self.assertEqual(crc, zlib.crc32(image[eibi.HEADER.size :]))
+
+            # First bucket entry points at the first record
+            self.assertEqual(struct.unpack_from("<I", image, buckets)[0], 0)
+
+    def test_odd_count_reads_back(self):
+        image = self.compile(3)
+        reader = eibi.ImageReader(io.BytesIO(image))
+        names = [r[3] for r in reader.records()]
+        self.assertEqual(names, [b"Station 0", b"Station 1", b"Station 2"])
+
+    def test_trim_keeps_high_bytes(self):
+        # Same as the firmware, which compares unsigned chars
+        self.assertEqual(eibi.trim(b" \t7325 R\xc3\xa9\r"), b"7325 R\xc3\xa9")
+
+
+class WordIndexTest(unittest.TestCase):
+    def test_only_station_names(self):
+        text = b"\n".join([
+            eibi_line(5900, "0000-0100", "Radio Romania Int.", lang="E", target="Eu"),
+            eibi_line(6000, "0000-0100", "Europe 1", lang="F", target="WEu"),
+            eibi_line(7000, "0000-0100", "Voice of Korea", lang="-CW", target="FE"),
+        ])
+        image = eibi.compile_schedule(text)
+        records, name_count, names_size, word_count, crc = image_layout(image)
+
+        base = eibi.HEADER.size + eibi.records_size(records) + (eibi.EIBI_BUCKETS + 1) * 4
+        words = struct.unpack_from("<%dI" % word_count, image, base + name_count * 4)
+        names = image[base + (name_count + word_count) * 4 :]
+        indexed = [names[w : names.index(b"\0", w)] for w in words]
+
+        # Words of station names only, sorted case insensitive
+        self.assertEqual(indexed, [b"1", b"Europe 1", b"Int.", b"Korea", b"of Korea",
+                                   b"Radio Romania Int.", b"Romania Int.", b"Voice of Korea"])
+
+
+class MergeTest(unittest.TestCase):
+    def merge(self, *paths):
+        sources = [eibi.open_source(os.path.join(DATA, p)) for p in paths]
+        out = io.BytesIO()
+        count, dropped = eibi.merge_schedules(sources, out)
+        for src in sources:
+            src.f.close()
+        return out.getvalue(), count, dropped
+
+    def records(self, image):
+        """Get (freq, start, name, days, source) for each record."""
+        reader = eibi.ImageReader(io.BytesIO(image))
+        result = []
+        for j in range(reader.count):
+            freq, start, end, name, lang, target, days, source = eibi.RECORD.unpack_from(image, eibi.HEADER.size + j * eibi.RECORD.size)
+            result.append((freq, start, reader.name(name), days, source))
+        return result
+
+    def test_merge_text(self):
+        image, count, dropped = self.merge("eibi-sample.txt", "secondary-sample.txt")
+        self.assertEqual((count, dropped), (8, 2))
+
+        # In frequency and time order, tagged with the source index.
+        # Dropped: "Radio Romania" (same station, overlapping time) and
+        # "Radio Habana Cuba" on Mondays (same station and weekday)
+        self.assertEqual(self.records(image), [
+            (5900, 0, b"Radio Romania Int.", eibi.EIBI_DAILY, 0),
+            (6000, 60, b"R Habana Cuba", 0x1F, 0),
+            (6000, 60, b"Radio Habana Cuba", 0x20, 1),
+            (7300, 600, b"China Radio Int.", eibi.EIBI_DAILY, 1),
+            (9500, 720, b"BBC World Service", eibi.EIBI_DAILY, 0),
+            (9500, 750, b"Deutsche Welle", eibi.EIBI_DAILY, 1),
+            (9500, 840, b"BBC WS", eibi.EIBI_DAILY, 1),
+            (11700, 0, b"Voice of Korea", eibi.EIBI_DAILY, 0),
+        ])
+
+        # Result is a valid image
+        records, name_count, names_size, word_count, crc = image_layout(image)
+        self.assertEqual(crc, zlib.crc32(image[eibi.HEADER.size :]))
+
+    def test_priority(self):
+        # The first source wins duplicates
+        image, count, dropped = self.merge("secondary-sample.txt", "eibi-sample.txt")
+        self.assertEqual((count, dropped), (8, 2))
+        names = [(r[2], r[4]) for r in self.records(image)]
+        self.assertIn((b"Radio Romania", 0), names)
+        self.assertNotIn((b"Radio Romania Int.", 1), names)
+        self.assertIn((b"Voice of Korea", 1), names)
+
+    def test_merge_image(self):
+        # Compiled images merge like their source text
+        compiled = eibi.compile_schedule(read_data("eibi-sample.txt"))
+        with tempfile.TemporaryDirectory() as tmp:
+            path = os.path.join(tmp, "schedules.bin")
+            with open(path, "wb") as f:
+                f.write(compiled)
+            image, count, dropped = self.merge(path, "secondary-sample.txt")
+        self.assertEqual((count, dropped), (8, 2))
+        self.assertEqual(image, self.merge("eibi-sample.txt", "secondary-sample.txt")[0])
+
+    def test_same_source_kept(self):
+        # Records are only duplicates of records from other sources
+        image, count, dropped = self.merge("secondary-sample.txt")
+        self.assertEqual((count, dropped), (6, 0))
+        self.assertEqual(self.records(image), self.records(eibi.compile_schedule(read_data("secondary-sample.txt"))))
+
+
+if __name__ == "__main__":
+    unittest.main()
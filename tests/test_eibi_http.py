@@ -0,0 +1,99 @@
+"""
+Host tests for the firmware EiBi downloader (eibiLoadSchedule() built
+as build/eibi_http), against a local server answering with 200, 304
+and gzip-encoded responses.
+
+Run with:
+    make -C tests check
+"""
+
+import os
+import tempfile
+import unittest
+
+import eibi_server
+from test_eibi import eibi, eibi_line
+
+DRIVER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "build", "eibi_http")
+
+
+def schedule_text(count, offset=0):
+    lines = [b"kHz:75 Time(UTC):93 Days:59 ITU:49 Station:201 Lng:49 Target:62", b""]
+    lines += [eibi_line(5900 + 5 * j + offset, "0000-0100", "Station %d" % j, lang="E", target="Eu") for j in range(count)]
+    return b"\r\n".join(lines) + b"\r\n"
+
+
+@unittest.skipUnless(os.path.exists(DRIVER), "build/eibi_http not built, run make -C tests check")
+class DownloadTest(unittest.TestCase):
+    def setUp(self):
+        self.tmp = tempfile.TemporaryDirectory()
+        self.root = self.tmp.name
+        self.path = os.path.join(self.root, "schedules.bin")
+
+    def tearDown(self):
+        self.server.close()
+        self.tmp.cleanup()
+
+    def serve(self, data, **kwargs):
+        self.server = eibi_server.EibiServer(data, **kwargs)
+
+    def load(self, loads=1):
+        return [(ok, status) for ok, _, status in eibi_server.run_loads(DRIVER, self.server.url, loads, self.root)]
+
+    def image(self):
+        with open(self.path, "rb") as f:
+            return f.read()
+
+    def test_200_builds_schedule(self):
+        text = schedule_text(500)
+        self.serve(text)
+        self.assertEqual(self.load(), [(True, "DONE!")])
+
+        # Same image as the host compiler
+        self.assertEqual(self.image(), eibi.compile_schedule(text))
+        self.assertNotIn("If-None-Match", self.server.requests[0])
+
+    def test_304_keeps_schedule(self):
+        self.serve(schedule_text(500))
+        self.assertEqual(self.load(2), [(True, "DONE!"), (True, "Up to date!")])
+
+        first, second = self.server.requests
+        self.assertNotIn("If-None-Match", first)
+        self.assertTrue(second["If-None-Match"].startswith('"'))
+        self.assertIn("GMT", second["If-Modified-Since"])
+
+    def test_changed_schedule_reloads(self):
+        text = schedule_text(500)
+        self.serve(text)
+        self.load()
+        self.server.update(schedule_text(600, offset=1))
+
+        # Validators from the first download no longer match
+        self.assertEqual(self.load(), [(True, "DONE!")])
+        self.assertEqual(self.image(), eibi.compile_schedule(self.server.data))
+
+    def test_gzip(self):
+        text = schedule_text(5000)
+        self.serve(text, compress=True)
+        self.assertEqual(self.load(), [(True, "DONE!")])
+
+        self.assertIn("gzip", self.server.requests[0]["Accept-Encoding"])
+        self.assertEqual(self.image(), eibi.compile_schedule(text))
+
+    def test_gzip_damaged(self):
+        text = schedule_text(5000)
+        self.serve(text, compress=True)
+        self.server.gzipped = self.server.gzipped[: len(self.server.gzipped) // 2]
+        self.assertEqual(self.load(), [(False, "Failed reading EiBi data!")])
+        self.assertFalse(os.path.exists(self.path))
+
+    def test_no_validators(self):
+        # Without ETag and Last-Modified every load downloads again
+        self.serve(schedule_text(100), validators=False)
+        self.assertEqual(self.load(2), [(True, "DONE!"), (True, "DONE!")])
+        self.assertNotIn("If-None-Match", self.server.requests[1])
+        self.assertNotIn("If-Modified-Since", self.server.requests[1])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,523 @@
+#!/usr/bin/env python3
+"""
+Compile EiBi schedules (eibi.txt) into the binary format used by the
+ATS-Mini firmware (see ats-mini/EIBI.h) and upload them over USB serial.
+
+The parser follows eibiParseLine() and replace_accented_char() in
+ats-mini/EIBI.cpp, so the result matches what the radio builds itself
+from a WiFi download.
+
+Usage:
+    eibi.py compile eibi.txt -o schedules.bin
+    eibi.py merge eibi.txt other.txt -o schedules.bin
+    eibi.py upload schedules.bin --port /dev/ttyACM0
+    eibi.py upload eibi.txt --port /dev/ttyACM0
+"""
+
+import argparse
+import heapq
+import io
+import itertools
+import re
+import struct
+import sys
+import zlib
+
+# Must match ats-mini/EIBI.h
+EIBI_MAGIC = 0x49424945
+EIBI_VERSION = 7
+EIBI_SORTED = 0x0001
+EIBI_ANYTIME = 0xFFFF
+EIBI_MAX_NAMES = 0xFFFF
+EIBI_NO_CODE = 0xFFFF
+EIBI_DAILY = 0x7F
+EIBI_BUCKETS = 256
+EIBI_BUCKET_MIN = 150
+EIBI_BUCKET_MAX = 30000
+EIBI_BUCKET_KHZ = (EIBI_BUCKET_MAX - EIBI_BUCKET_MIN + EIBI_BUCKETS - 1) // EIBI_BUCKETS
+
+HEADER = struct.Struct("<IHHIIIIII")
+RECORD = struct.Struct("<HHHHHHBB")
+
+
+def records_size(count):
+    """Size of the record array, padded to keep the tables after it aligned."""
+    return (count * RECORD.size + 3) & ~3
+
+# Must match ats-mini/EIBI.cpp
+COL_FREQ = 0
+COL_TIME = 14
+COL_DAYS = 23
+COL_ITU = 29
+COL_NAME = 34
+LEN_NAME = 24
+COL_LANG = 58
+LEN_LANG = 5
+COL_TARGET = 63
+LEN_TARGET = 5
+
+DAY_NAMES = (b"Mo", b"Tu", b"We", b"Th", b"Fr", b"Sa", b"Su")
+
+ACCENTS = {}
+for chars, plain in (
+    ((0xE1, 0xE0, 0xE2, 0xE3, 0xE4), "a"),
+    ((0xE9, 0xE8, 0xEA, 0xEB), "e"),
+    ((0xED, 0xEC, 0xEE, 0xEF), "i"),
+    ((0xF3, 0xF2, 0xF4, 0xF5, 0xF6), "o"),
+    ((0xFA, 0xF9, 0xFB, 0xFC), "u"),
+    ((0xC1, 0xC0, 0xC2, 0xC3, 0xC4), "A"),
+    ((0xC9, 0xC8, 0xCA, 0xCB), "E"),
+    ((0xCD, 0xCC, 0xCE, 0xCF), "I"),
+    ((0xD3, 0xD2, 0xD4, 0xD5, 0xD6), "O"),
+    ((0xDA, 0xD9, 0xDB, 0xDC), "U"),
+    ((0xF1,), "n"),
+    ((0xD1,), "N"),
+    ((0xE7,), "c"),
+    ((0xC7,), "C"),
+):
+    for c in chars:
+        ACCENTS[c] = ord(plain)
+
+FLOAT_RE = re.compile(rb"\s*([+-]?(\d+\.?\d*|\.\d+)([eE][+-]?\d+)?)")
+
+
+def atof(data):
+    """C atof(): parse the longest numeric prefix, 0 if none."""
+    m = FLOAT_RE.match(data)
+    return float(m.group(1)) if m else 0.0
+
+
+def scan_time(data):
+    """C sscanf(data, "%2d%2d-%2d%2d"), returning four ints or None."""
+    values = []
+    pos = 0
+    for sep in (b"", b"", b"-", b""):
+        if data[pos : pos + len(sep)] != sep:
+            return None
+        pos += len(sep)
+        while data[pos : pos + 1].isspace():
+            pos += 1
+        m = re.match(rb"[+-]?\d+", data[pos : pos + 2])
+        if not m:
+            return None
+        values.append(int(m.group(0)))
+        pos += m.end()
+    return values
+
+
+def column(line, col, width):
+    """Get a trimmed column with accents replaced, like eibiColumn()."""
+    text = line[col : col + width].strip(b" \t")
+    return bytes(ACCENTS.get(c, c) for c in text)
+
+
+def parse_days(days):
+    """Parse weekdays into a bitmask (bit 0 = Monday), like eibiParseDays()."""
+    result = 0
+    last = -1
+    rng = False
+    pos = 0
+    while pos < len(days):
+        c = days[pos : pos + 1]
+        if b"1" <= c <= b"7":
+            day = days[pos] - ord("1")
+            pos += 1
+        elif c == b"-" and last >= 0:
+            rng = True
+            pos += 1
+            continue
+        elif c == b",":
+            pos += 1
+            continue
+        elif days[pos : pos + 2] in DAY_NAMES:
+            day = DAY_NAMES.index(days[pos : pos + 2])
+            pos += 2
+        else:
+            return EIBI_DAILY
+
+        # Ranges may wrap around the week, as in "Sa-Mo"
+        j = (last + 1) % 7 if rng else day
+        while True:
+            result |= 1 << j
+            if j == day:
+                break
+            j = (j + 1) % 7
+
+        last = day
+        rng = False
+
+    return result or EIBI_DAILY
+
+
+def parse_line(line):
+    """Parse one trimmed schedule line, like eibiParseLine()."""
+    if len(line) < COL_NAME:
+        return None
+
+    freq = int(atof(line[COL_FREQ:COL_TIME])) & 0xFFFF
+    if not freq:
+        return None
+
+    t = scan_time(line[COL_TIME:COL_DAYS])
+    if t is None:
+        return None
+    sh, sm, eh, em = t
+    start = EIBI_ANYTIME if sh < 0 else (sh * 60 + sm) & 0xFFFF
+    end = EIBI_ANYTIME if eh < 0 else (eh * 60 + em) & 0xFFFF
+
+    days = parse_days(column(line, COL_DAYS, COL_ITU - COL_DAYS))
+
+    if b"Jammer" in line[COL_NAME : COL_NAME + LEN_NAME]:
+        return None
+
+    name = column(line, COL_NAME, LEN_NAME)
+    lang = column(line, COL_LANG, LEN_LANG)
+    target = column(line, COL_TARGET, LEN_TARGET)
+    return freq, start, end, days, name, lang, target
+
+
+def trim(line):
+    """Remove leading and trailing bytes the firmware treats as blanks."""
+    # Firmware compares unsigned chars against ' ', keeping bytes >= 0x80
+    blank = lambda c: c <= 0x20
+    i, j = 0, len(line)
+    while i < j and blank(line[i]):
+        i += 1
+    while j > i and blank(line[j - 1]):
+        j -= 1
+    return line[i:j]
+
+
+def freq_bucket(freq):
+    if freq < EIBI_BUCKET_MIN:
+        return 0
+    return min((freq - EIBI_BUCKET_MIN) // EIBI_BUCKET_KHZ, EIBI_BUCKETS - 1)
+
+
+def is_alnum(text, j):
+    return text[j : j + 1].isalnum()
+
+
+class ImageWriter:
+    """
+    Write a compiled schedule from records arriving in order. Records
+    go straight to the output file, so only the name table stays in
+    memory. The header is written last.
+    """
+
+    def __init__(self, f):
+        self.f = f
+        self.names = {}
+        self.stations = set()
+        self.count = 0
+        self.crc = 0
+        self.last = (0, 0, 0)
+        self.buckets = [None] * (EIBI_BUCKETS + 1)
+        f.write(b"\0" * HEADER.size)
+
+    def intern_any(self, name):
+        if name not in self.names:
+            if len(self.names) >= EIBI_MAX_NAMES:
+                return None
+            self.names[name] = len(self.names)
+        return self.names[name]
+
+    def intern(self, name):
+        """Get name table ID for a station name, or None if the table is full."""
+        id = self.intern_any(name)
+        if id is not None:
+            self.stations.add(id)
+        return id
+
+    def intern_code(self, code):
+        """Get name table ID for a language or target code."""
+        code = self.intern_any(code) if code else None
+        return EIBI_NO_CODE if code is None else code
+
+    def add(self, record):
+        """Add (freq, start, end, name, lang, target, days, source) record."""
+        if record[:3] < self.last:
+            raise ValueError("records out of order at %d kHz" % record[0])
+        self.last = record[:3]
+
+        # First record in or after each frequency bucket
+        b = freq_bucket(record[0])
+        while b >= 0 and self.buckets[b] is None:
+            self.buckets[b] = self.count
+            b -= 1
+
+        data = RECORD.pack(*record)
+        self.crc = zlib.crc32(data, self.crc)
+        self.f.write(data)
+        self.count += 1
+
+    def close(self):
+        buckets = [self.count if b is None else b for b in self.buckets]
+        padding = b"\0" * (records_size(self.count) - self.count * RECORD.size)
+
+        offsets = []
+        words = []
+        text = b""
+        for id, name in enumerate(self.names):
+            offsets.append(len(text))
+            # Only station names are searched, not language and target codes
+            if id in self.stations:
+                words += [len(text) + j for j in range(len(name)) if is_alnum(name, j) and (j == 0 or not is_alnum(name, j - 1))]
+            text += name + b"\0"
+
+        # Name words, sorted by the (case folded) text starting at each word
+        words.sort(key=lambda j: text[j : text.index(b"\0", j)].lower())
+
+        tail = padding
+        tail += struct.pack("<%dI" % len(buckets), *buckets)
+        tail += struct.pack("<%dI" % len(offsets), *offsets)
+        tail += struct.pack("<%dI" % len(words), *words)
+        tail += text
+        self.f.write(tail)
+
+        header = HEADER.pack(
+            EIBI_MAGIC,
+            EIBI_VERSION,
+            RECORD.size,
+            self.count,
+            len(self.names),
+            len(text),
+            len(words),
+            EIBI_SORTED,
+            zlib.crc32(tail, self.crc),
+        )
+        self.f.seek(0)
+        self.f.write(header)
+        self.f.seek(0, io.SEEK_END)
+
+
+class ImageReader:
+    """Read records from a compiled schedule, one at a time."""
+
+    def __init__(self, f):
+        self.f = f
+        header = HEADER.unpack(f.read(HEADER.size))
+        magic, version, rec_size, self.count, name_count, names_size, word_count = header[:7]
+        if magic != EIBI_MAGIC or version != EIBI_VERSION or rec_size != RECORD.size:
+            raise ValueError("not a version %d schedule image" % EIBI_VERSION)
+
+        # Name table sits after records and frequency directory
+        f.seek(HEADER.size + records_size(self.count) + (EIBI_BUCKETS + 1) * 4)
+        offsets = struct.unpack("<%dI" % name_count, f.read(name_count * 4))
+        f.seek(word_count * 4, io.SEEK_CUR)
+        text = f.read(names_size)
+        self.names = [text[o : text.index(b"\0", o)] for o in offsets]
+
+    def name(self, id):
+        return self.names[id] if id < len(self.names) else b""
+
+    def records(self):
+        """Yield records with their names, codes and days, in order."""
+        self.f.seek(HEADER.size)
+        for _ in range(self.count):
+            freq, start, end, name, lang, target, days, source = RECORD.unpack(self.f.read(RECORD.size))
+            yield freq, start, end, self.name(name), self.name(lang), self.name(target), days
+
+
+def compile_schedule(text):
+    """Compile eibi.txt contents (bytes) into a schedule image (bytes)."""
+    out = io.BytesIO()
+    writer = ImageWriter(out)
+    records = []
+
+    # Intern names in file order, as the firmware does
+    for line in text.split(b"\n"):
+        line = trim(line)
+        if not line or not line[:1].isdigit():
+            continue
+        entry = parse_line(line)
+        if entry is None:
+            continue
+        freq, start, end, days, name, lang, target = entry
+        name = writer.intern(name)
+        if name is None:
+            continue
+        # Language and target codes share the name table
+        lang = writer.intern_code(lang)
+        target = writer.intern_code(target)
+        records.append((freq, start, end, name, lang, target, days, 0))
+
+    records.sort(key=lambda r: r[:3])
+    for r in records:
+        writer.add(r)
+
+    writer.close()
+    return out.getvalue()
+
+
+def open_source(path):
+    """Open a schedule image or eibi.txt file for merging."""
+    f = open(path, "rb")
+    if f.read(4) == struct.pack("<I", EIBI_MAGIC):
+        f.seek(0)
+        return ImageReader(f)
+    f.seek(0)
+    data = f.read()
+    f.close()
+    return ImageReader(io.BytesIO(compile_schedule(data)))
+
+
+# Words that do not tell stations apart
+GENERIC_WORDS = {b"r", b"radio", b"rdi", b"the", b"voice", b"v", b"of", b"la", b"de", b"del", b"di"}
+
+
+def name_words(name):
+    return re.findall(rb"[a-z0-9]+", name.lower())
+
+
+def similar_names(a, b):
+    """
+    Check if names refer to the same station: ignoring case and
+    punctuation, either one extends the other, or they share the
+    first word that is not generic ("R Habana" and "Radio Habana",
+    "BBC WS" and "BBC World Service").
+    """
+    a, b = name_words(a), name_words(b)
+    if not a or not b:
+        return False
+    ja, jb = b"".join(a), b"".join(b)
+    if ja.startswith(jb) or jb.startswith(ja):
+        return True
+    ka = [w for w in a if w not in GENERIC_WORDS]
+    kb = [w for w in b if w not in GENERIC_WORDS]
+    return bool(ka) and bool(kb) and ka[0] == kb[0]
+
+
+def time_spans(start, end):
+    """Split schedule time into non-wrapping minute spans."""
+    if start == EIBI_ANYTIME or end == EIBI_ANYTIME:
+        return [(0, 24 * 60 - 1)]
+    if start <= end:
+        return [(start, end)]
+    return [(start, 24 * 60 - 1), (0, end)]
+
+
+def times_overlap(a, b):
+    return any(s1 <= e2 and s2 <= e1 for s1, e1 in time_spans(a[1], a[2]) for s2, e2 in time_spans(b[1], b[2]))
+
+
+def is_duplicate(a, b):
+    """Records from different sources for the same broadcast."""
+    return a[7] != b[7] and a[0] == b[0] and (a[6] & b[6]) and times_overlap(a, b) and similar_names(a[3], b[3])
+
+
+def merge_schedules(sources, out):
+    """
+    Merge sorted record streams from several sources into one compiled
+    schedule, k-way, one frequency at a time. A record is dropped if an
+    earlier source already has the same broadcast. Each record is tagged
+    with the index of its source. Returns (records, duplicates).
+    """
+    def tagged(src, tag):
+        for r in src.records():
+            yield r + (tag,)
+
+    streams = [tagged(src, tag) for tag, src in enumerate(sources)]
+    writer = ImageWriter(out)
+    dropped = 0
+
+    for freq, group in itertools.groupby(heapq.merge(*streams, key=lambda r: r[:3]), key=lambda r: r[0]):
+        kept = []
+        for r in sorted(group, key=lambda r: r[7]):
+            if any(is_duplicate(r, k) for k in kept):
+                dropped += 1
+            else:
+                kept.append(r)
+
+        for freq, start, end, name, lang, target, days, tag in sorted(kept, key=lambda r: r[:3]):
+            name = writer.intern(name)
+            if name is None:
+                continue
+            writer.add((freq, start, end, name, writer.intern_code(lang), writer.intern_code(target), days, tag))
+
+    writer.close()
+    return writer.count, dropped
+
+
+def load_image(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == EIBI_MAGIC:
+        return data
+    return compile_schedule(data)
+
+
+def upload(image, port, baudrate):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("Uploading needs pyserial (pip install pyserial)")
+
+    def reply(s):
+        while True:
+            line = s.readline()
+            if not line:
+                sys.exit("No response from the radio")
+            line = line.strip()
+            if line.startswith(b"[EIBI]"):
+                return line
+
+    # Erasing flash takes a while, only send the rest of the image
+    # once the radio is done with the header
+    with serial.Serial(port, baudrate, timeout=30) as s:
+        s.reset_input_buffer()
+        s.write(b":EIBI UPLOAD %d %08x\n" % (len(image), zlib.crc32(image)))
+
+        line = reply(s)
+        if line == b"[EIBI] Ready":
+            s.write(image[: HEADER.size])
+            line = reply(s)
+            if line == b"[EIBI] Continue":
+                s.write(image[HEADER.size :])
+                s.flush()
+                line = reply(s)
+
+        print(line.decode(errors="replace"))
+        return line == b"[EIBI] OK"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("compile", help="compile eibi.txt into a schedule image")
+    p.add_argument("input", help="eibi.txt file")
+    p.add_argument("-o", "--output", default="schedules.bin", help="output image file")
+
+    p = sub.add_parser("merge", help="merge several schedules, dropping duplicates")
+    p.add_argument("inputs", nargs="+", help="schedule images or eibi.txt files, in order of priority")
+    p.add_argument("-o", "--output", default="schedules.bin", help="output image file")
+
+    p = sub.add_parser("upload", help="upload schedule image (or eibi.txt) to the radio")
+    p.add_argument("input", help="schedule image or eibi.txt file")
+    p.add_argument("-p", "--port", required=True, help="serial port")
+    p.add_argument("-b", "--baudrate", type=int, default=115200, help="serial baud rate")
+
+    args = parser.parse_args()
+
+    if args.command == "compile":
+        with open(args.input, "rb") as f:
+            image = compile_schedule(f.read())
+        with open(args.output, "wb") as f:
+            f.write(image)
+        count, name_count = struct.unpack_from("<II", image, 8)
+        print("%s: %d entries, %d names, %d bytes" % (args.output, count, name_count, len(image)))
+    elif args.command == "merge":
+        sources = [open_source(path) for path in args.inputs]
+        with open(args.output, "wb") as f:
+            count, dropped = merge_schedules(sources, f)
+        for src in sources:
+            src.f.close()
+        print("%s: %d entries, %d duplicates dropped" % (args.output, count, dropped))
+    else:
+        if not upload(load_image(args.input), args.port, args.baudrate):
+            sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""
+Fetch scans from ATS-Mini radios over USB serial and convert them to
+CSV, so that sweeps from several receivers can be collected and
+compared. The binary frame is written by scanExport() in
+ats-mini/Scan.cpp. The band monitor log (ats-mini/Monitor.cpp) is a
+sequence of such frames.
+
+Usage:
+    scan.py fetch --port /dev/ttyACM0 -o scan.bin
+    scan.py fetch --port /dev/ttyACM0 -o scan.csv
+    scan.py fetch --port /dev/ttyACM0 --log -o monitor.csv
+    scan.py csv scan1.bin scan2.bin -o scans.csv
+"""
+
+import argparse
+import csv
+import datetime
+import struct
+import sys
+import zlib
+
+# Must match ats-mini/Scan.cpp
+SCAN_FRAME_MAGIC = 0x4E414353
+SCAN_FRAME_VERSION = 1
+SCAN_FRAME_FM = 0x01
+SCAN_FRAME_FREQS = 0x02
+
+HEADER = struct.Struct("<IBBBBHHHHII")
+CRC = struct.Struct("<I")
+
+# Must match bandModeDesc[] in ats-mini/Menu.cpp
+MODES = ("FM", "LSB", "USB", "AM")
+
+
+class ScanFrame:
+    def __init__(self, data):
+        if len(data) < HEADER.size + CRC.size:
+            raise ValueError("frame too short")
+
+        (magic, version, self.flags, self.band, self.mode, self.start,
+         self.step, count, _, self.time, self.uptime) = HEADER.unpack_from(data)
+
+        if magic != SCAN_FRAME_MAGIC:
+            raise ValueError("not a scan frame")
+        if version != SCAN_FRAME_VERSION:
+            raise ValueError("unsupported frame version %d" % version)
+
+        point = 4 if self.flags & SCAN_FRAME_FREQS else 2
+        size = HEADER.size + count * point + CRC.size
+        if len(data) < size:
+            raise ValueError("frame truncated (%d of %d bytes)" % (len(data), size))
+        if zlib.crc32(data[:size - CRC.size]) != CRC.unpack_from(data, size - CRC.size)[0]:
+            raise ValueError("frame CRC mismatch")
+
+        self.size = size
+        self.points = []
+        for j in range(count):
+            off = HEADER.size + j * point
+            if self.flags & SCAN_FRAME_FREQS:
+                freq, rssi, snr = struct.unpack_from("<HBB", data, off)
+            else:
+                freq = self.start + j * self.step
+                rssi, snr = struct.unpack_from("<BB", data, off)
+            self.points.append((freq, rssi, snr))
+
+    def khz(self, freq):
+        return freq * 10 if self.flags & SCAN_FRAME_FM else freq
+
+    def timestamp(self):
+        if not self.time:
+            return ""
+        return datetime.datetime.fromtimestamp(self.time, datetime.timezone.utc).strftime("%Y-%m-%dT%H:%M:%SZ")
+
+    def mode_name(self):
+        return MODES[self.mode] if self.mode < len(MODES) else str(self.mode)
+
+
+def read_frames(data):
+    """Decode all frames found back to back in data."""
+    frames = []
+    while data:
+        frame = ScanFrame(data)
+        frames.append(frame)
+        data = data[frame.size:]
+    return frames
+
+
+CSV_FIELDS = ("source", "time", "uptime_ms", "band", "mode", "freq_khz", "rssi_dbuv", "snr_db")
+
+
+def write_csv(out, sources):
+    writer = csv.writer(out)
+    writer.writerow(CSV_FIELDS)
+    for name, frame in sources:
+        for freq, rssi, snr in frame.points:
+            writer.writerow((name, frame.timestamp(), frame.uptime, frame.band,
+                             frame.mode_name(), frame.khz(freq), rssi, snr))
+
+
+def fetch(port, baudrate, log=False):
+    try:
+        import serial
+    except ImportError:
+        sys.exit("Fetching needs pyserial (pip install pyserial)")
+
+    command, tag, reply = (b":MONITOR LOG\n", b"[MONITOR]", b"[MONITOR] Log ") if log else \
+                          (b":SCAN DUMP\n", b"[SCAN]", b"[SCAN] Frame ")
+
+    with serial.Serial(port, baudrate, timeout=5) as s:
+        s.reset_input_buffer()
+        s.write(command)
+
+        while True:
+            line = s.readline()
+            if not line:
+                sys.exit("No response from the radio")
+            line = line.strip()
+            if line.startswith(reply):
+                size = int(line[len(reply):])
+                break
+            if line.startswith(tag):
+                sys.exit(line.decode(errors="replace"))
+
+        data = s.read(size)
+        if len(data) != size:
+            sys.exit("Frame truncated (%d of %d bytes)" % (len(data), size))
+        return data
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("fetch", help="fetch the last scan (or the monitor log) from the radio")
+    p.add_argument("--log", action="store_true", help="fetch the band monitor log")
+    p.add_argument("-p", "--port", required=True, help="serial port")
+    p.add_argument("-b", "--baudrate", type=int, default=115200, help="serial baud rate")
+    p.add_argument("-o", "--output", default="scan.bin", help="output frame (.bin) or CSV (.csv) file")
+
+    p = sub.add_parser("csv", help="convert scan frames to CSV")
+    p.add_argument("inputs", nargs="+", help="scan frame files, one per receiver or sweep")
+    p.add_argument("-o", "--output", default="-", help="output CSV file")
+
+    args = parser.parse_args()
+
+    if args.command == "fetch":
+        data = fetch(args.port, args.baudrate, args.log)
+        frames = read_frames(data)
+        if args.output.endswith(".csv"):
+            with open(args.output, "w", newline="") as f:
+                write_csv(f, [(args.port, frame) for frame in frames])
+        else:
+            with open(args.output, "wb") as f:
+                f.write(data)
+        print("%s: %d scans, %d points" % (args.output, len(frames), sum(len(f.points) for f in frames)))
+    else:
+        sources = []
+        for path in args.inputs:
+            with open(path, "rb") as f:
+                try:
+                    sources += [(path, frame) for frame in read_frames(f.read())]
+                except ValueError as e:
+                    sys.exit("%s: %s" % (path, e))
+        if args.output == "-":
+            write_csv(sys.stdout, sources)
+        else:
+            with open(args.output, "w", newline="") as f:
+                write_csv(f, sources)
+
+
+if __name__ == "__main__":
+    main()